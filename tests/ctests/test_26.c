@@ -0,0 +1,105 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_26
+// Summary: MEMINFO: free and per-process page counts follow a map's lifetime
+// ====================================================================
+
+char *test_name = "TEST_26";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    struct meminfo before;
+    if (meminfo(&before) != SUCCESS) {
+        printerr("meminfo() failed\n");
+        failed();
+    }
+    if (before.free_pages <= 0 || before.free_pages > before.total_pages) {
+        printerr("free_pages = %d, total_pages = %d\n", before.free_pages,
+                 before.total_pages);
+        failed();
+    }
+    printf(1, "INFO: %d of %d pages free. \tOkay.\n", before.free_pages,
+           before.total_pages);
+
+    //
+    // Place and touch an anonymous map
+    //
+    int n_pages = 50;
+    int length = n_pages * PGSIZE;
+    int anon = MAP_FIXED | MAP_ANONYMOUS | MAP_SHARED;
+    uint map = wmap(MMAPBASE, length, anon, 0);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    for (int i = 0; i < length; i += PGSIZE) {
+        arr[i] = 'a';
+    }
+
+    struct meminfo during;
+    struct pmeminfo pm;
+    meminfo(&during);
+    if (during.free_pages > before.free_pages - n_pages) {
+        printerr("free_pages = %d after touching %d pages, was %d\n",
+                 during.free_pages, n_pages, before.free_pages);
+        failed();
+    }
+    if (pmeminfo(0, &pm) != SUCCESS || pm.pid != getpid()) {
+        printerr("pmeminfo() failed\n");
+        failed();
+    }
+    if (pm.wmap != n_pages || pm.resident < n_pages) {
+        printerr("wmap = %d, resident = %d, expected %d wmap pages\n", pm.wmap,
+                 pm.resident, n_pages);
+        failed();
+    }
+    printf(1, "INFO: %d wmap pages resident. \tOkay.\n", pm.wmap);
+
+    //
+    // Fork: the child's heap is copy-on-write and shared with the parent
+    //
+    int pid = fork();
+    if (pid == 0) {
+        sleep(100);
+        exit();
+    }
+    if (pmeminfo(pid, &pm) != SUCCESS || pm.pid != pid) {
+        printerr("pmeminfo(%d) failed\n", pid);
+        failed();
+    }
+    if (pm.cow == 0 || pm.shared < n_pages) {
+        printerr("child: cow = %d, shared = %d\n", pm.cow, pm.shared);
+        failed();
+    }
+    printf(1, "INFO: child has %d cow and %d shared pages. \tOkay.\n", pm.cow,
+           pm.shared);
+    wait();
+
+    //
+    // Unmap: the pages come back
+    //
+    if (wunmap(map) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    struct meminfo after;
+    meminfo(&after);
+    // allow a few pages for copy-on-write breaks in the parent after fork
+    if (after.free_pages < during.free_pages + n_pages - 8) {
+        printerr("free_pages = %d after unmapping, %d while mapped\n",
+                 after.free_pages, during.free_pages);
+        failed();
+    }
+    pmeminfo(0, &pm);
+    if (pm.wmap != 0) {
+        printerr("wmap = %d after unmapping\n", pm.wmap);
+        failed();
+    }
+    printf(1, "INFO: pages freed after unmap. \tOkay.\n");
+
+    success();
+}
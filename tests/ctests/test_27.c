@@ -0,0 +1,119 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_27
+// Summary: OFFSET: Map a window in the middle of a file and write it back
+// ====================================================================
+
+char *test_name = "TEST_27";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    char *filename = "big.txt";
+    int N_PAGES = 6;
+    char val = 50;
+    int filelength = create_big_file(filename, N_PAGES, val);
+
+    //
+    // An offset that is not page-aligned is rejected
+    //
+    int filebacked = MAP_FIXED | MAP_SHARED;
+    uint addr = MMAPBASE;
+    int fd = open_file(filename, filelength);
+    uint map = wmapoff(addr, PGSIZE, filebacked, fd, 100);
+    if (map != FAILED) {
+        printerr("wmapoff() with offset 100 returned 0x%x\n", map);
+        failed();
+    }
+    printf(1, "INFO: Unaligned offset rejected. \tOkay.\n");
+
+    //
+    // Map pages 3 and 4 of the file
+    //
+    int first = 3;
+    int n_win = 2;
+    uint length = n_win * PGSIZE;
+    map = wmapoff(addr, length, filebacked, fd, first * PGSIZE);
+    if (map != addr) {
+        printerr("wmapoff() returned %d\n", (int)map);
+        failed();
+    }
+    struct wmapinfo winfo;
+    get_n_validate_wmap_info(&winfo, 1);   // 1 map exists
+    map_exists(&winfo, map, length, TRUE); // map 1 exists
+    printf(1, "INFO: Placed map 1 at 0x%x with length %d. \tOkay.\n", map, length);
+
+    //
+    // Access the map, touching the middle of each page first
+    //
+    char *arr = (char *)map;
+    for (int pg = 0; pg < n_win; pg++) {
+        int mid = pg * PGSIZE + PGSIZE / 2;
+        if (arr[mid] != val + first + pg) {
+            printerr("addr 0x%x contains %d, expected %d\n", map + mid, arr[mid],
+                     val + first + pg);
+            failed();
+        }
+        for (int i = 0; i < PGSIZE; i++) {
+            int offset = pg * PGSIZE + i;
+            if (arr[offset] != val + first + pg) {
+                printerr("addr 0x%x contains %d, expected %d\n", map + offset,
+                         arr[offset], val + first + pg);
+                failed();
+            }
+        }
+    }
+    get_n_validate_wmap_info(&winfo, 1);       // 1 map exists
+    map_allocated(&winfo, map, length, n_win); // both pages loaded
+    printf(1, "INFO: Map 1 shows pages %d to %d of the file. \tOkay.\n", first,
+           first + n_win - 1);
+
+    //
+    // Edit the map and unmap it
+    //
+    char newval = 7;
+    for (int i = 0; i < length; i++) {
+        arr[i] = newval;
+    }
+    int ret = wunmap(map);
+    if (ret < 0) {
+        printerr("wunmap() returned %d\n", ret);
+        failed();
+    }
+    get_n_validate_wmap_info(&winfo, 0); // no maps exist
+    close(fd);
+    printf(1, "INFO: Map 1 unmapped. \tOkay.\n");
+
+    //
+    // Only the mapped window of the file changed
+    //
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printerr("Failed to open file %s\n", filename);
+        failed();
+    }
+    int bufflen = 512;
+    char buff[bufflen];
+    for (int i = 0; i < filelength; i += bufflen) {
+        if (read(fd, buff, bufflen) != bufflen) {
+            printerr("Read from file %s FAILED, offset %d\n", filename, i);
+            failed();
+        }
+        int pg = i / PGSIZE;
+        char expected = (pg >= first && pg < first + n_win) ? newval : val + pg;
+        for (int j = 0; j < bufflen; j++) {
+            if (buff[j] != expected) {
+                printerr("file %s offset %d = %d, expected %d\n", filename, i + j,
+                         buff[j], expected);
+                failed();
+            }
+        }
+    }
+    close(fd);
+    printf(1, "INFO: Only the window was written back. \tOkay.\n");
+
+    // test ends
+    success();
+}
@@ -0,0 +1,127 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_28
+// Summary: PRIVATE: Writes to a MAP_PRIVATE map reach neither the file nor a forked child
+// ====================================================================
+
+char *test_name = "TEST_28";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    char *filename = "big.txt";
+    int N_PAGES = 3;
+    char val = 20;
+    int filelength = create_big_file(filename, N_PAGES, val);
+
+    //
+    // MAP_SHARED and MAP_PRIVATE together are rejected
+    //
+    uint addr = MMAPBASE;
+    uint length = filelength;
+    int fd = open_file(filename, filelength);
+    uint map = wmap(addr, length, MAP_FIXED | MAP_SHARED | MAP_PRIVATE, fd);
+    if (map != FAILED) {
+        printerr("wmap() with both MAP_SHARED and MAP_PRIVATE returned 0x%x\n", map);
+        failed();
+    }
+
+    //
+    // Place a private filebacked map and read it
+    //
+    map = wmap(addr, length, MAP_FIXED | MAP_PRIVATE, fd);
+    if (map != addr) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    struct wmapinfo winfo;
+    get_n_validate_wmap_info(&winfo, 1);   // 1 map exists
+    map_exists(&winfo, map, length, TRUE); // map 1 exists
+    char *arr = (char *)map;
+    for (int i = 0; i < length; i++) {
+        if (arr[i] != val + i / PGSIZE) {
+            printerr("addr 0x%x contains %d, expected %d\n", map + i, arr[i],
+                     val + i / PGSIZE);
+            failed();
+        }
+    }
+    printf(1, "INFO: Private map 1 shows the file. \tOkay.\n");
+
+    //
+    // Edit the map; the edit is visible in the map only
+    //
+    char newval = 99;
+    for (int i = 0; i < length; i++) {
+        arr[i] = newval;
+    }
+    for (int i = 0; i < length; i++) {
+        if (arr[i] != newval) {
+            printerr("addr 0x%x contains %d, expected %d\n", map + i, arr[i],
+                     newval);
+            failed();
+        }
+    }
+    if (wunmap(map) < 0) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    close(fd);
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printerr("Failed to open file %s\n", filename);
+        failed();
+    }
+    int bufflen = 512;
+    char buff[bufflen];
+    for (int i = 0; i < length; i += bufflen) {
+        if (read(fd, buff, bufflen) != bufflen) {
+            printerr("Read from file %s FAILED, offset %d\n", filename, i);
+            failed();
+        }
+        for (int j = 0; j < bufflen; j++) {
+            if (buff[j] != val + i / PGSIZE) {
+                printerr("file %s offset %d = %d, expected %d\n", filename, i + j,
+                         buff[j], val + i / PGSIZE);
+                failed();
+            }
+        }
+    }
+    close(fd);
+    printf(1, "INFO: Private edits were not written back. \tOkay.\n");
+
+    //
+    // A private anonymous map is copy-on-write across fork
+    //
+    map = wmap(addr, PGSIZE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1);
+    if (map != addr) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    arr = (char *)map;
+    arr[0] = 1;
+    int pid = fork();
+    if (pid < 0) {
+        printerr("fork() failed\n");
+        failed();
+    }
+    if (pid == 0) {
+        if (arr[0] != 1) {
+            printerr("child sees %d, expected 1\n", arr[0]);
+            failed();
+        }
+        arr[0] = 2;
+        exit();
+    }
+    wait();
+    if (arr[0] != 1) {
+        printerr("parent sees %d after the child's write, expected 1\n", arr[0]);
+        failed();
+    }
+    printf(1, "INFO: Child's write stayed private. \tOkay.\n");
+
+    // test ends
+    success();
+}
@@ -0,0 +1,102 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_29
+// Summary: SHM: A named shared-memory object opened twice maps the same pages
+// ====================================================================
+
+char *test_name = "TEST_29";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    char *name = "seg";
+    int n_pages = 2;
+    int size = n_pages * PGSIZE;
+    int shared = MAP_FIXED | MAP_SHARED;
+
+    //
+    // Create the object and map it
+    //
+    int fd = shm_open(name, size);
+    if (fd < 0) {
+        printerr("shm_open() returned %d\n", fd);
+        failed();
+    }
+    uint map = wmap(MMAPBASE, size + PGSIZE, shared, fd);
+    if (map != FAILED) {
+        printerr("wmap() past the end of the object returned 0x%x\n", map);
+        failed();
+    }
+    map = wmap(MMAPBASE, size, shared, fd);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    for (int i = 0; i < size; i++) {
+        arr[i] = i % 100;
+    }
+    printf(1, "INFO: Created and filled object %s. \tOkay.\n", name);
+
+    //
+    // The child opens the object by name and maps it somewhere else
+    //
+    int pid = fork();
+    if (pid < 0) {
+        printerr("fork() failed\n");
+        failed();
+    }
+    if (pid == 0) {
+        int cfd = shm_open(name, 0);
+        if (cfd < 0) {
+            printerr("child: shm_open() returned %d\n", cfd);
+            failed();
+        }
+        uint cmap = wmap(MMAPBASE + 0x100000, size, shared, cfd);
+        if (cmap != MMAPBASE + 0x100000) {
+            printerr("child: wmap() returned %d\n", (int)cmap);
+            failed();
+        }
+        char *carr = (char *)cmap;
+        for (int i = 0; i < size; i++) {
+            if (carr[i] != i % 100) {
+                printerr("child: offset %d = %d, expected %d\n", i, carr[i],
+                         i % 100);
+                failed();
+            }
+            carr[i] = 100 - i % 100;
+        }
+        exit();
+    }
+    wait();
+    for (int i = 0; i < size; i++) {
+        if (arr[i] != 100 - i % 100) {
+            printerr("offset %d = %d, expected %d\n", i, arr[i], 100 - i % 100);
+            failed();
+        }
+    }
+    printf(1, "INFO: The child's writes through its own map are visible. \tOkay.\n");
+
+    //
+    // Unlink; the name is gone
+    //
+    if (wunmap(map) < 0) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    close(fd);
+    if (shm_unlink(name) < 0) {
+        printerr("shm_unlink() failed\n");
+        failed();
+    }
+    if ((fd = shm_open(name, 0)) >= 0) {
+        printerr("shm_open() of an unlinked name returned %d\n", fd);
+        failed();
+    }
+    printf(1, "INFO: Object %s unlinked. \tOkay.\n", name);
+
+    // test ends
+    success();
+}
@@ -0,0 +1,86 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_30
+// Summary: FLUSH: Dirty pages of a mapped file reach the file before wunmap
+// ====================================================================
+
+char *test_name = "TEST_30";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    //
+    // Knobs can be read and set, within range
+    //
+    int interval = vmtune(VM_FLUSH_INTERVAL, -1);
+    int expire = vmtune(VM_DIRTY_EXPIRE, -1);
+    if (interval <= 0 || expire < 0) {
+        printerr("vmtune() read interval %d, expire %d\n", interval, expire);
+        failed();
+    }
+    if (vmtune(VM_FLUSH_INTERVAL, 0) != FAILED || vmtune(NVMTUNE, 1) != FAILED) {
+        printerr("vmtune() accepted an invalid setting\n");
+        failed();
+    }
+    if (vmtune(VM_FLUSH_INTERVAL, 5) != interval || vmtune(VM_DIRTY_EXPIRE, 0) != expire) {
+        printerr("vmtune() did not return the old values\n");
+        failed();
+    }
+    printf(1, "INFO: Flush every 5 ticks, expire after 0. \tOkay.\n");
+
+    //
+    // Map a file, dirty it and wait for the flusher
+    //
+    char *filename = "big.txt";
+    int N_PAGES = 2;
+    char val = 40;
+    int filelength = create_big_file(filename, N_PAGES, val);
+    int fd = open_file(filename, filelength);
+    uint map = wmap(MMAPBASE, filelength, MAP_FIXED | MAP_SHARED, fd);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    char newval = 88;
+    for (int i = 0; i < filelength; i++) {
+        arr[i] = newval;
+    }
+    sleep(50);
+
+    //
+    // The file already has the new contents while the map is still there
+    //
+    int rfd = open(filename, O_RDONLY);
+    if (rfd < 0) {
+        printerr("Failed to open file %s\n", filename);
+        failed();
+    }
+    int bufflen = 512;
+    char buff[bufflen];
+    for (int i = 0; i < filelength; i += bufflen) {
+        if (read(rfd, buff, bufflen) != bufflen) {
+            printerr("Read from file %s FAILED, offset %d\n", filename, i);
+            failed();
+        }
+        for (int j = 0; j < bufflen; j++) {
+            if (buff[j] != newval) {
+                printerr("file %s offset %d = %d, expected %d\n", filename, i + j,
+                         buff[j], newval);
+                failed();
+            }
+        }
+    }
+    close(rfd);
+    printf(1, "INFO: Edits were written back while mapped. \tOkay.\n");
+
+    wunmap(map);
+    close(fd);
+    vmtune(VM_FLUSH_INTERVAL, interval);
+    vmtune(VM_DIRTY_EXPIRE, expire);
+
+    // test ends
+    success();
+}
@@ -0,0 +1,85 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_31
+// Summary: SWAP: Cold anonymous pages are swapped to zram and fault back intact
+// ====================================================================
+
+char *test_name = "TEST_31";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    //
+    // Fill an anonymous map
+    //
+    int n_pages = 8;
+    int size = n_pages * PGSIZE;
+    uint map = wmap(MMAPBASE, size, MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS, -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    for (int i = 0; i < size; i++) {
+        arr[i] = i % 100;
+    }
+    printf(1, "INFO: Filled %d pages. \tOkay.\n", n_pages);
+
+    //
+    // Make kswapd reclaim all it can, and leave the map alone meanwhile
+    //
+    int interval = vmtune(VM_SWAP_INTERVAL, 2);
+    // raising high first, since low may not go above it
+    int high = vmtune(VM_SWAP_HIGH, 100);
+    int low = vmtune(VM_SWAP_LOW, 100);
+    if (interval <= 0 || low < 0 || high < 0) {
+        printerr("vmtune() read interval %d, low %d, high %d\n", interval, low, high);
+        failed();
+    }
+    sleep(50);
+    vmtune(VM_SWAP_INTERVAL, interval);
+    vmtune(VM_SWAP_LOW, low);
+    vmtune(VM_SWAP_HIGH, high);
+    if (vmtune(VM_SWAP_LOW, high + 1) != FAILED) {
+        printerr("vmtune() let the low watermark go above the high one\n");
+        failed();
+    }
+
+    struct meminfo mi;
+    if (meminfo(&mi) != SUCCESS) {
+        printerr("meminfo() failed\n");
+        failed();
+    }
+    if (mi.swap_pages < n_pages || mi.zram_bytes <= 0 || mi.zram_bytes >= size) {
+        printerr("swap_pages = %d, zram_bytes = %d\n", mi.swap_pages, mi.zram_bytes);
+        failed();
+    }
+    printf(1, "INFO: %d pages swapped into %d bytes. \tOkay.\n", mi.swap_pages,
+           mi.zram_bytes);
+
+    //
+    // Touching the map brings the pages back
+    //
+    for (int i = 0; i < size; i++) {
+        if (arr[i] != i % 100) {
+            printerr("offset %d = %d, expected %d\n", i, arr[i], i % 100);
+            failed();
+        }
+    }
+    meminfo(&mi);
+    if (mi.swap_pages != 0) {
+        printerr("swap_pages = %d after reading the map back\n", mi.swap_pages);
+        failed();
+    }
+    printf(1, "INFO: Contents read back intact. \tOkay.\n");
+
+    if (wunmap(map) < 0) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+
+    // test ends
+    success();
+}
@@ -0,0 +1,79 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_32
+// Summary: KSM: Identical private pages are merged and split again on write
+// ====================================================================
+
+char *test_name = "TEST_32";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    //
+    // Fill a private anonymous map with identical pages
+    //
+    int n_pages = 8;
+    int size = n_pages * PGSIZE;
+    uint map = wmap(MMAPBASE, size, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    for (int i = 0; i < size; i++) {
+        arr[i] = i % PGSIZE % 100;
+    }
+    printf(1, "INFO: Filled %d identical pages. \tOkay.\n", n_pages);
+
+    //
+    // Let ksmd make a few passes
+    //
+    struct meminfo before, after;
+    meminfo(&before);
+    int interval = vmtune(VM_KSM_INTERVAL, 2);
+    if (interval < 0) {
+        printerr("vmtune() read interval %d\n", interval);
+        failed();
+    }
+    sleep(50);
+    vmtune(VM_KSM_INTERVAL, interval);
+    if (meminfo(&after) != SUCCESS) {
+        printerr("meminfo() failed\n");
+        failed();
+    }
+    if (after.ksm_saved < n_pages - 1 || after.ksm_merges - before.ksm_merges < n_pages - 1) {
+        printerr("ksm_saved = %d, ksm_merges = %d\n", after.ksm_saved,
+                 after.ksm_merges - before.ksm_merges);
+        failed();
+    }
+    printf(1, "INFO: %d pages saved by merging. \tOkay.\n", after.ksm_saved);
+
+    //
+    // A write to one page leaves the others as they were
+    //
+    arr[3 * PGSIZE] = 111;
+    for (int i = 0; i < size; i++) {
+        char want = i == 3 * PGSIZE ? 111 : i % PGSIZE % 100;
+        if (arr[i] != want) {
+            printerr("offset %d = %d, expected %d\n", i, arr[i], want);
+            failed();
+        }
+    }
+    meminfo(&after);
+    if (after.ksm_saved != n_pages - 2) {
+        printerr("ksm_saved = %d after a write, expected %d\n", after.ksm_saved,
+                 n_pages - 2);
+        failed();
+    }
+    printf(1, "INFO: A write split one page off. \tOkay.\n");
+
+    if (wunmap(map) < 0) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+
+    // test ends
+    success();
+}
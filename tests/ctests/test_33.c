@@ -0,0 +1,99 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_33
+// Summary: THP: A full 4MB anonymous span becomes one huge page, split by fork
+// ====================================================================
+
+char *test_name = "TEST_33";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    //
+    // Map and touch a 4MB-aligned, 4MB anonymous region
+    //
+    int n_pages = 1024;
+    int size = n_pages * PGSIZE;
+    uint map = wmap(MMAPBASE, size, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    for (int i = 0; i < size; i += PGSIZE / 4) {
+        arr[i] = (i / PGSIZE) % 100;
+    }
+    printf(1, "INFO: Touched %d pages. \tOkay.\n", n_pages);
+
+    //
+    // Let khugepaged collapse it
+    //
+    int interval = vmtune(VM_THP_INTERVAL, 2);
+    if (interval < 0) {
+        printerr("vmtune() read interval %d\n", interval);
+        failed();
+    }
+    sleep(50);
+    vmtune(VM_THP_INTERVAL, interval);
+
+    struct pmeminfo pm;
+    if (pmeminfo(0, &pm) != SUCCESS) {
+        printerr("pmeminfo() failed\n");
+        failed();
+    }
+    if (pm.huge != 1) {
+        printerr("pmeminfo() reports %d huge pages, expected 1\n", pm.huge);
+        failed();
+    }
+    uint base = va2pa(map);
+    for (int i = 0; i < n_pages; i++) {
+        if (va2pa(map + i * PGSIZE) != base + i * PGSIZE) {
+            printerr("page %d is not contiguous with page 0\n", i);
+            failed();
+        }
+    }
+    struct wmapinfo winfo;
+    get_n_validate_wmap_info(&winfo, 1);
+    map_exists(&winfo, map, size, TRUE);
+    if (winfo.n_loaded_pages[0] != n_pages) {
+        printerr("n_loaded_pages = %d, expected %d\n", winfo.n_loaded_pages[0], n_pages);
+        failed();
+    }
+    for (int i = 0; i < size; i += PGSIZE / 4) {
+        if (arr[i] != (i / PGSIZE) % 100) {
+            printerr("offset %d = %d, expected %d\n", i, arr[i], (i / PGSIZE) % 100);
+            failed();
+        }
+    }
+    printf(1, "INFO: Region is one huge page with its contents. \tOkay.\n");
+
+    //
+    // fork splits it again; the child gets its own copy on write
+    //
+    int pid = fork();
+    if (pid < 0) {
+        printerr("fork() failed\n");
+        failed();
+    }
+    if (pid == 0) {
+        arr[0] = 77;
+        exit();
+    }
+    wait();
+    pmeminfo(0, &pm);
+    if (pm.huge != 0 || arr[0] != 0) {
+        printerr("after fork: %d huge pages, arr[0] = %d\n", pm.huge, arr[0]);
+        failed();
+    }
+    printf(1, "INFO: fork split the huge page. \tOkay.\n");
+
+    if (wunmap(map) < 0) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+
+    // test ends
+    success();
+}
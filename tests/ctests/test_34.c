@@ -0,0 +1,72 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_34
+// Summary: FAULTSTAT: Page faults are counted by type per process and in total
+// ====================================================================
+
+char *test_name = "TEST_34";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    struct faultstat before, after;
+    if (faultstat(0, &before) != SUCCESS) {
+        printerr("faultstat() failed\n");
+        failed();
+    }
+    if (faultstat(12345, &after) != FAILED) {
+        printerr("faultstat() of a missing pid succeeded\n");
+        failed();
+    }
+
+    //
+    // Zero-fill faults on an anonymous map
+    //
+    int n_pages = 3;
+    uint map = wmap(MMAPBASE, n_pages * PGSIZE, MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS, -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    for (int i = 0; i < n_pages; i++) {
+        arr[i * PGSIZE] = i;
+    }
+    faultstat(0, &after);
+    int anon = after.count[FAULT_ANON] - before.count[FAULT_ANON];
+    if (anon != n_pages || after.cycles[FAULT_ANON] <= before.cycles[FAULT_ANON]) {
+        printerr("%d anonymous faults counted, expected %d\n", anon, n_pages);
+        failed();
+    }
+    printf(1, "INFO: %d zero-fill faults counted. \tOkay.\n", anon);
+
+    //
+    // A copy-on-write fault in a child shows up in the totals
+    //
+    char *heap = malloc(PGSIZE);
+    heap[0] = 1;
+    faultstat(-1, &before);
+    int pid = fork();
+    if (pid < 0) {
+        printerr("fork() failed\n");
+        failed();
+    }
+    if (pid == 0) {
+        heap[0] = 2;
+        exit();
+    }
+    wait();
+    faultstat(-1, &after);
+    if (after.count[FAULT_COW] <= before.count[FAULT_COW]) {
+        printerr("no copy-on-write fault counted in the totals\n");
+        failed();
+    }
+    printf(1, "INFO: The child's copy-on-write fault was counted. \tOkay.\n");
+
+    wunmap(map);
+
+    // test ends
+    success();
+}
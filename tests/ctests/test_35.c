@@ -0,0 +1,74 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_35
+// Summary: FAULTAROUND: A sequential fill maps anonymous pages in batches
+// ====================================================================
+
+char *test_name = "TEST_35";
+
+// touch each page of a fresh anonymous map in order; return the
+// zero-fill faults and fault-around pages it took
+void fill(uint addr, int n_pages, int *faults, int *around) {
+    struct faultstat before, after;
+    uint map = wmap(addr, n_pages * PGSIZE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1);
+    if (map != addr) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    faultstat(0, &before);
+    for (int i = 0; i < n_pages; i++) {
+        if (arr[i * PGSIZE] != 0) {
+            printerr("page %d is not zeroed\n", i);
+            failed();
+        }
+        arr[i * PGSIZE] = i;
+    }
+    faultstat(0, &after);
+    *faults = after.count[FAULT_ANON] - before.count[FAULT_ANON];
+    *around = after.around - before.around;
+
+    struct wmapinfo winfo;
+    get_n_validate_wmap_info(&winfo, 1);
+    map_allocated(&winfo, map, n_pages * PGSIZE, n_pages);
+    if (wunmap(map) < 0) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+}
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    int n_pages = 64;
+    int faults, around;
+
+    //
+    // With fault-around, most pages come without a fault of their own
+    //
+    fill(MMAPBASE, n_pages, &faults, &around);
+    if (faults + around != n_pages || faults > n_pages / 4) {
+        printerr("%d faults and %d pages mapped around for %d pages\n", faults, around,
+                 n_pages);
+        failed();
+    }
+    printf(1, "INFO: %d pages took %d faults. \tOkay.\n", n_pages, faults);
+
+    //
+    // Without it, one fault per page
+    //
+    int old = vmtune(VM_FAULT_AROUND, 1);
+    fill(MMAPBASE, n_pages, &faults, &around);
+    vmtune(VM_FAULT_AROUND, old);
+    if (faults != n_pages || around != 0) {
+        printerr("%d faults and %d pages mapped around with fault-around off\n", faults,
+                 around);
+        failed();
+    }
+    printf(1, "INFO: With fault-around off, %d faults. \tOkay.\n", faults);
+
+    // test ends
+    success();
+}
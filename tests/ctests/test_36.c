@@ -0,0 +1,70 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_36
+// Summary: WPROTECT: A write to a page made read-only causes a Segmentation Fault
+// ====================================================================
+
+char *test_name = "TEST_36";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    int n_pages = 4;
+    uint map = wmap(MMAPBASE, n_pages * PGSIZE, MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS, -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    arr[0] = 10;
+    arr[PGSIZE] = 11;
+
+    //
+    // Bad arguments are refused
+    //
+    if (wprotect(map + 1, PGSIZE, PROT_READ) != FAILED ||
+        wprotect(map, PGSIZE, PROT_WRITE) != FAILED ||
+        wprotect(map, (n_pages + 1) * PGSIZE, PROT_READ) != FAILED) {
+        printerr("wprotect() accepted bad arguments\n");
+        failed();
+    }
+
+    //
+    // Make pages 1 and 2 read-only: page 1 is mapped, page 2 isn't yet
+    //
+    if (wprotect(map + PGSIZE, 2 * PGSIZE, PROT_READ) != SUCCESS) {
+        printerr("wprotect() failed\n");
+        failed();
+    }
+    if (arr[PGSIZE] != 11 || arr[2 * PGSIZE] != 0) {
+        printerr("read-only pages read %d and %d\n", arr[PGSIZE], arr[2 * PGSIZE]);
+        failed();
+    }
+    arr[0] = 20;
+    arr[3 * PGSIZE] = 23;
+    printf(1, "INFO: Read-only pages can be read, the others written. \tOkay.\n");
+
+    //
+    // Page 2 becomes writable again
+    //
+    if (wprotect(map + 2 * PGSIZE, PGSIZE, PROT_READ | PROT_WRITE) != SUCCESS) {
+        printerr("wprotect() failed\n");
+        failed();
+    }
+    arr[2 * PGSIZE] = 22;
+    if (arr[2 * PGSIZE] != 22) {
+        printerr("page 2 reads %d after a write\n", arr[2 * PGSIZE]);
+        failed();
+    }
+    printf(1, "INFO: Page made writable again. \tOkay.\n");
+
+    //
+    // Page 1 is still read-only
+    //
+    arr[PGSIZE] = 'a'; // this should cause a segfault
+
+    // test ends
+    success();
+}
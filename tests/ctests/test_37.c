@@ -0,0 +1,107 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_37
+// Summary: UFFD: A child process supplies the pages of its parent's map
+// ====================================================================
+
+char *test_name = "TEST_37";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    int fd = uffd();
+    if (fd < 0) {
+        printerr("uffd() returned %d\n", fd);
+        failed();
+    }
+
+    //
+    // Only anonymous maps can be registered
+    //
+    int n_pages = 3;
+    int length = n_pages * PGSIZE;
+    if (wmap(MMAPBASE, length, MAP_FIXED | MAP_PRIVATE | MAP_UFFD, fd) != FAILED) {
+        printerr("wmap() registered a file map\n");
+        failed();
+    }
+    uint map = wmap(MMAPBASE, length, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS | MAP_UFFD, fd);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+
+    char val = 70;
+    int pid = fork();
+    if (pid < 0) {
+        printerr("fork() failed\n");
+        failed();
+    } else if (pid == 0) {
+        //
+        // Handler: page 0 gets a pattern, the others zeroes
+        //
+        char *buf = malloc(PGSIZE);
+        for (int i = 0; i < PGSIZE; i++) {
+            buf[i] = val;
+        }
+        uint addr;
+        int n;
+        while ((n = read(fd, &addr, sizeof(addr))) == sizeof(addr)) {
+            if (addr % PGSIZE || addr < map || addr >= map + length) {
+                printerr("Handler: read fault address 0x%x\n", addr);
+                failed();
+            }
+            if (addr == map) {
+                if (wcopy(fd, addr, buf, PGSIZE) != PGSIZE) {
+                    printerr("Handler: wcopy(0x%x) failed\n", addr);
+                    failed();
+                }
+                if (wcopy(fd, addr, buf, PGSIZE) != FAILED) {
+                    printerr("Handler: wcopy() replaced a mapped page\n");
+                    failed();
+                }
+            } else if (wzero(fd, addr, PGSIZE) != PGSIZE) {
+                printerr("Handler: wzero(0x%x) failed\n", addr);
+                failed();
+            }
+        }
+        if (n != 0) {
+            printerr("Handler: read() returned %d\n", n);
+            failed();
+        }
+        exit();
+    }
+
+    //
+    // Touch every page; each waits for the handler
+    //
+    char *arr = (char *)map;
+    for (int i = 0; i < length; i += PGSIZE) {
+        char expected = i == 0 ? val : 0;
+        if (arr[i] != expected || arr[i + PGSIZE - 1] != expected) {
+            printerr("addr 0x%x contains %d, expected %d\n", map + i, arr[i], expected);
+            failed();
+        }
+    }
+    arr[PGSIZE] = val + 1;
+    if (arr[PGSIZE] != val + 1) {
+        printerr("write to a supplied page was lost\n");
+        failed();
+    }
+    printf(1, "INFO: Handler supplied all %d pages. \tOkay.\n", n_pages);
+
+    //
+    // Unmapping the last registered map ends the handler
+    //
+    if (wunmap(map) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    wait();
+    close(fd);
+    printf(1, "INFO: Handler exits after wunmap. \tOkay.\n");
+
+    // test ends
+    success();
+}
@@ -0,0 +1,86 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_38
+// Summary: IDLE: kidled counts the pages of a map touched between scans
+// ====================================================================
+
+char *test_name = "TEST_38";
+
+// Wait for kidled to scan this process again, touching pages [0, n)
+// of arr meanwhile, and return what it saw.
+void next_scan(char *arr, int n, struct wsinfo *ws) {
+    int scans;
+    if (getwsinfo(0, ws) != SUCCESS) {
+        printerr("getwsinfo() failed\n");
+        failed();
+    }
+    scans = ws->scans;
+    while (ws->scans == scans) {
+        for (int i = 0; i < n; i++) {
+            arr[i * PGSIZE]++;
+        }
+        getwsinfo(0, ws);
+    }
+}
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    struct wsinfo ws;
+    if (getwsinfo(12345, &ws) != FAILED) {
+        printerr("getwsinfo() of a missing pid succeeded\n");
+        failed();
+    }
+
+    int n_pages = 8;
+    uint map = wmap(MMAPBASE, n_pages * PGSIZE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    for (int i = 0; i < n_pages; i++) {
+        arr[i * PGSIZE] = i;
+    }
+    int interval = vmtune(VM_IDLE_INTERVAL, 5);
+
+    //
+    // Touching 3 pages: the scan sees all 8 resident, 3 of them touched
+    //
+    next_scan(arr, 0, &ws);
+    next_scan(arr, 3, &ws);
+    if (ws.total_mmaps != 1 || ws.addr[0] != map) {
+        printerr("getwsinfo() reports %d maps, the first at 0x%x\n", ws.total_mmaps, ws.addr[0]);
+        failed();
+    }
+    if (ws.resident[0] != n_pages || ws.touched[0] != 3) {
+        printerr("map has %d pages resident, %d touched; expected %d, 3\n",
+                 ws.resident[0], ws.touched[0], n_pages);
+        failed();
+    }
+    if (ws.heap_touched <= 0 || ws.heap_touched > ws.heap_resident) {
+        printerr("heap has %d pages resident, %d touched\n", ws.heap_resident, ws.heap_touched);
+        failed();
+    }
+    printf(1, "INFO: 3 of %d pages touched. \tOkay.\n", n_pages);
+
+    //
+    // Left alone, the map goes idle
+    //
+    sleep(20);
+    getwsinfo(0, &ws);
+    if (ws.resident[0] != n_pages || ws.touched[0] != 0) {
+        printerr("idle map has %d pages resident, %d touched; expected %d, 0\n",
+                 ws.resident[0], ws.touched[0], n_pages);
+        failed();
+    }
+    printf(1, "INFO: Map is idle while sleeping. \tOkay.\n");
+
+    vmtune(VM_IDLE_INTERVAL, interval);
+    wunmap(map);
+
+    // test ends
+    success();
+}
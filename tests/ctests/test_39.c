@@ -0,0 +1,101 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_39
+// Summary: CHECKPOINT: A process restored from a checkpoint has its old memory and files
+// ====================================================================
+
+char *test_name = "TEST_39";
+
+int counter;
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    //
+    // State to save: a global, a map with a pattern, a file offset
+    //
+    int n_pages = 2;
+    uint map = wmap(MMAPBASE, n_pages * PGSIZE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    for (int i = 0; i < n_pages * PGSIZE; i++) {
+        arr[i] = i % 100;
+    }
+    counter = 5;
+
+    char *filename = "ck.txt";
+    int fd = open(filename, O_CREATE | O_RDWR);
+    if (fd < 0 || write(fd, "abcdef", 6) != 6) {
+        printerr("Failed to create file %s\n", filename);
+        failed();
+    }
+    close(fd);
+    fd = open(filename, O_RDONLY);
+    char buf[3] = {0};
+    read(fd, buf, 2);
+
+    int r = checkpoint("ckpt.img");
+    if (r < 0) {
+        printerr("checkpoint() failed\n");
+        failed();
+    }
+
+    if (r == 0) {
+        //
+        // Change everything, then go back
+        //
+        read(fd, buf, 2);
+        counter = 99;
+        for (int i = 0; i < n_pages * PGSIZE; i++) {
+            arr[i] = 0;
+        }
+        printf(1, "INFO: Checkpoint written, state changed. \tOkay.\n");
+        restore("ckpt.img");
+        printerr("restore() returned\n");
+        failed();
+    }
+
+    //
+    // Restored: the map comes back lazily, with its old contents
+    //
+    struct wmapinfo winfo;
+    get_n_validate_wmap_info(&winfo, 1);
+    if (winfo.addr[0] != map || winfo.n_loaded_pages[0] != 0) {
+        printerr("restored map at 0x%x has %d pages loaded, expected 0x%x, 0\n",
+                 winfo.addr[0], winfo.n_loaded_pages[0], map);
+        failed();
+    }
+    for (int i = 0; i < n_pages * PGSIZE; i++) {
+        if (arr[i] != i % 100) {
+            printerr("addr 0x%x contains %d, expected %d\n", map + i, arr[i], i % 100);
+            failed();
+        }
+    }
+    arr[0] = 42;
+    if (arr[0] != 42) {
+        printerr("write to the restored map was lost\n");
+        failed();
+    }
+    if (counter != 5) {
+        printerr("counter is %d, expected 5\n", counter);
+        failed();
+    }
+    printf(1, "INFO: Memory restored. \tOkay.\n");
+
+    if (read(fd, buf, 2) != 2 || buf[0] != 'c' || buf[1] != 'd') {
+        printerr("read \"%s\" after restore, expected \"cd\"\n", buf);
+        failed();
+    }
+    close(fd);
+    printf(1, "INFO: File offset restored. \tOkay.\n");
+
+    wunmap(map);
+
+    // test ends
+    success();
+}
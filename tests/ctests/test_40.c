@@ -0,0 +1,90 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_40
+// Summary: ZYGOTE: Children spawned from a template get fresh memory, argv and fds
+// ====================================================================
+
+char *test_name = "TEST_40";
+
+int marker = 7;
+
+// Run in a spawned child: report marker and argv[2] on the pipe
+// whose write end is argv[1].
+void child(char *argv[]) {
+    int fd = atoi(argv[1]);
+    char msg[8];
+    msg[0] = '0' + marker;
+    msg[1] = argv[2][0];
+    marker = 8; // only this child's copy changes
+    if (write(fd, msg, 2) != 2) {
+        printerr("Child: write to fd %d failed\n", fd);
+    }
+    exit();
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 3) {
+        child(argv);
+    }
+
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    int id = zygote("tester");
+    if (id < 0) {
+        printerr("zygote() returned %d\n", id);
+        failed();
+    }
+    if (zygote("no-such-file") != FAILED || spawn_from(id + 1, argv) != FAILED) {
+        printerr("zygote() or spawn_from() accepted a bad argument\n");
+        failed();
+    }
+
+    int fds[2];
+    if (pipe(fds) < 0) {
+        printerr("pipe() failed\n");
+        failed();
+    }
+    char fdarg[4];
+    fdarg[0] = '0' + fds[1];
+    fdarg[1] = 0;
+    marker = 9; // the template has the value from the file
+
+    //
+    // Two children from the same template, each with its own argv
+    //
+    char *names[2] = {"a", "b"};
+    for (int i = 0; i < 2; i++) {
+        char *cargv[] = {"tester", fdarg, names[i], 0};
+        int pid = spawn_from(id, cargv);
+        if (pid <= 0) {
+            printerr("spawn_from() returned %d\n", pid);
+            failed();
+        }
+        char msg[3] = {0};
+        if (read(fds[0], msg, 2) != 2) {
+            printerr("read from child %d failed\n", i);
+            failed();
+        }
+        if (msg[0] != '7' || msg[1] != names[i][0]) {
+            printerr("child %d reported \"%s\", expected \"7%s\"\n", i, msg, names[i]);
+            failed();
+        }
+        if (wait() != pid) {
+            printerr("wait() did not return child %d\n", i);
+            failed();
+        }
+    }
+    if (marker != 9) {
+        printerr("marker is %d in the parent, expected 9\n", marker);
+        failed();
+    }
+    printf(1, "INFO: Spawned children saw their own argv and fresh data. \tOkay.\n");
+
+    close(fds[0]);
+    close(fds[1]);
+
+    // test ends
+    success();
+}
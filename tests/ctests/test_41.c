@@ -0,0 +1,120 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_41
+// Summary: SCHED: Children queued on the forking CPU are stolen by the idle one
+// ====================================================================
+
+char *test_name = "TEST_41";
+
+#define NCHILD 6
+#define ROUNDS 20
+
+// Alternate between spinning and sleeping, so the child goes back on a
+// run queue both by preemption and by wakeup, then report on fd.
+void child(int i, int fd) {
+    volatile uint x = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int j = 0; j < 200000; j++) {
+            x += j;
+        }
+        if (i % 2 == 0) {
+            sleep(1);
+        }
+    }
+    char c = 'a' + i;
+    if (write(fd, &c, 1) != 1) {
+        printerr("Child %d: write failed\n", i);
+    }
+    exit();
+}
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    int fds[2];
+    if (pipe(fds) < 0) {
+        printerr("pipe() failed\n");
+        failed();
+    }
+
+    int pids[NCHILD];
+    for (int i = 0; i < NCHILD; i++) {
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            printerr("fork() failed\n");
+            failed();
+        }
+        if (pids[i] == 0) {
+            close(fds[0]);
+            child(i, fds[1]);
+        }
+    }
+    close(fds[1]);
+
+    //
+    // Every child reports once
+    //
+    int seen[NCHILD] = {0};
+    char c;
+    for (int i = 0; i < NCHILD; i++) {
+        if (read(fds[0], &c, 1) != 1 || c < 'a' || c >= 'a' + NCHILD || seen[c - 'a']) {
+            printerr("report %d from the children is missing or bad\n", i);
+            failed();
+        }
+        seen[c - 'a'] = 1;
+    }
+
+    //
+    // fork queues every child on this CPU; with a second CPU idle
+    // meanwhile, some of them must have been stolen by it
+    //
+    struct schedinfo si;
+    if (getschedinfo(12345, &si) != FAILED) {
+        printerr("getschedinfo() of a missing pid succeeded\n");
+        failed();
+    }
+    int steals = 0;
+    for (int i = 0; i < NCHILD; i++) {
+        if (getschedinfo(pids[i], &si) != SUCCESS) {
+            printerr("getschedinfo() of child %d failed\n", i);
+            failed();
+        }
+        if (si.runs <= 0 || si.steals > si.runs || si.lastcpu < 0) {
+            printerr("child %d: %d runs, %d steals, last on cpu %d\n",
+                     i, si.runs, si.steals, si.lastcpu);
+            failed();
+        }
+        steals += si.steals;
+    }
+    if (steals == 0) {
+        printerr("no child was stolen by the other CPU\n");
+        failed();
+    }
+    printf(1, "INFO: Children were stolen %d times. \tOkay.\n", steals);
+
+    //
+    // wait() returns each child once, then nothing is left
+    //
+    for (int i = 0; i < NCHILD; i++) {
+        int pid = wait();
+        int k;
+        for (k = 0; k < NCHILD; k++) {
+            if (pids[k] == pid) {
+                break;
+            }
+        }
+        if (k == NCHILD) {
+            printerr("wait() returned %d, not a remaining child\n", pid);
+            failed();
+        }
+        pids[k] = 0;
+    }
+    if (wait() != FAILED) {
+        printerr("wait() found a child after all had exited\n");
+        failed();
+    }
+
+    success();
+}
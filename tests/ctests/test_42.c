@@ -0,0 +1,72 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_42
+// Summary: MEMINFO: All memory the BIOS reports is used, not just the first 224MB
+// ====================================================================
+
+char *test_name = "TEST_42";
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    struct meminfo mi;
+    if (meminfo(&mi) != SUCCESS) {
+        printerr("meminfo() failed\n");
+        failed();
+    }
+
+    //
+    // qemu runs with -m 512: the allocator must have pages past the old
+    // fixed PHYSTOP, yet none of the firmware's reserved memory at the top
+    //
+    int old_pages = OLDPHYSTOP / PGSIZE;
+    int max_pages = PHYSTOP / PGSIZE;
+    if (mi.total_pages <= old_pages || mi.total_pages >= max_pages) {
+        printerr("total_pages = %d, expected between %d and %d\n", mi.total_pages,
+                 old_pages, max_pages);
+        failed();
+    }
+    printf(1, "INFO: %d pages handed to the allocator. \tOkay.\n", mi.total_pages);
+
+    //
+    // Touch more memory than the old limit left free, so that pages
+    // from above it are handed out and used
+    //
+    int n_pages = old_pages;
+    int length = n_pages * PGSIZE;
+    int anon = MAP_FIXED | MAP_ANONYMOUS | MAP_PRIVATE;
+    uint map = wmap(MMAPBASE, length, anon, -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    uint top = 0;
+    for (int i = 0; i < n_pages; i++) {
+        char *p = (char *)map + i * PGSIZE;
+        *p = i % 128;
+        uint pa = get_n_validate_va2pa((uint)p);
+        if (pa > top) {
+            top = pa;
+        }
+    }
+    for (int i = 0; i < n_pages; i++) {
+        if (*((char *)map + i * PGSIZE) != i % 128) {
+            printerr("page %d of the map lost its contents\n", i);
+            failed();
+        }
+    }
+    if (top < OLDPHYSTOP) {
+        printerr("highest page at 0x%x, expected one above 0x%x\n", top, OLDPHYSTOP);
+        failed();
+    }
+    printf(1, "INFO: Touched %d pages, up to 0x%x. \tOkay.\n", n_pages, top);
+
+    if (wunmap(map) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+
+    success();
+}
@@ -0,0 +1,119 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_43
+// Summary: KALLOC: Children on two CPUs allocate and free pages without losing any
+// ====================================================================
+
+char *test_name = "TEST_43";
+
+#define NCHILD 4
+#define NPAGES 2048
+#define ROUNDS 3
+
+// Fill a fresh map with values only this child and round write, check
+// them all once every page is in, and give the map back; report on fd
+// if nothing went wrong. A page handed to two children at once, or not
+// zeroed, shows up as a wrong value.
+void child(int i, int fd) {
+    for (int r = 0; r < ROUNDS; r++) {
+        uint map = wmap(MMAPBASE, NPAGES * PGSIZE,
+                        MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1);
+        if (map != MMAPBASE) {
+            printerr("Child %d: wmap() returned %d\n", i, (int)map);
+            exit();
+        }
+        for (int j = 0; j < NPAGES; j++) {
+            int *p = (int *)(map + j * PGSIZE);
+            if (p[0] != 0 || p[PGSIZE / sizeof(int) - 1] != 0) {
+                printerr("Child %d: page %d is not zeroed\n", i, j);
+                exit();
+            }
+            p[0] = p[PGSIZE / sizeof(int) - 1] = (i << 24) | (r << 16) | j;
+        }
+        for (int j = 0; j < NPAGES; j++) {
+            int *p = (int *)(map + j * PGSIZE);
+            int want = (i << 24) | (r << 16) | j;
+            if (p[0] != want || p[PGSIZE / sizeof(int) - 1] != want) {
+                printerr("Child %d: page %d holds 0x%x, expected 0x%x\n", i, j, p[0],
+                         want);
+                exit();
+            }
+        }
+        if (wunmap(map) != SUCCESS) {
+            printerr("Child %d: wunmap() failed\n", i);
+            exit();
+        }
+    }
+    char c = 'a' + i;
+    write(fd, &c, 1);
+    exit();
+}
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    struct meminfo before;
+    if (meminfo(&before) != SUCCESS) {
+        printerr("meminfo() failed\n");
+        failed();
+    }
+
+    int fds[2];
+    if (pipe(fds) < 0) {
+        printerr("pipe() failed\n");
+        failed();
+    }
+    for (int i = 0; i < NCHILD; i++) {
+        int pid = fork();
+        if (pid < 0) {
+            printerr("fork() failed\n");
+            failed();
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            child(i, fds[1]);
+        }
+    }
+    close(fds[1]);
+
+    //
+    // Every child sees only its own values
+    //
+    int n = 0;
+    char c;
+    while (read(fds[0], &c, 1) == 1) {
+        n++;
+    }
+    close(fds[0]);
+    for (int i = 0; i < NCHILD; i++) {
+        if (wait() < 0) {
+            printerr("wait() failed\n");
+            failed();
+        }
+    }
+    if (n != NCHILD) {
+        printerr("%d of %d children finished intact\n", n, NCHILD);
+        failed();
+    }
+    printf(1, "INFO: %d children filled %d pages %d times. \tOkay.\n", NCHILD, NPAGES,
+           ROUNDS);
+
+    //
+    // Every page comes back, wherever it was freed; free_pages counts
+    // the per-CPU caches too
+    //
+    struct meminfo after;
+    meminfo(&after);
+    // allow a few pages taken meanwhile by the memory daemons
+    if (after.free_pages < before.free_pages - 16) {
+        printerr("free_pages = %d after the children, %d before\n", after.free_pages,
+                 before.free_pages);
+        failed();
+    }
+    printf(1, "INFO: %d pages free after, %d before. \tOkay.\n", after.free_pages,
+           before.free_pages);
+
+    success();
+}
@@ -0,0 +1,77 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_44
+// Summary: KALLOC: Pages freed with data in them come back zeroed, pool or not
+// ====================================================================
+
+char *test_name = "TEST_44";
+
+#define NPAGES 512
+
+// Map NPAGES anonymous pages, check that each is all zeroes, and fill
+// them with junk before unmapping, so that the next map reuses dirty
+// pages.
+void cycle(int round) {
+    uint map = wmap(MMAPBASE, NPAGES * PGSIZE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    for (int j = 0; j < NPAGES; j++) {
+        uint *p = (uint *)(map + j * PGSIZE);
+        for (int k = 0; k < PGSIZE / sizeof(uint); k++) {
+            if (p[k] != 0) {
+                printerr("round %d: word %d of page %d is 0x%x\n", round, k, j, p[k]);
+                failed();
+            }
+        }
+        memset(p, 0xff, PGSIZE);
+    }
+    if (wunmap(map) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+}
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    //
+    // Pages freed just now, straight back from the free lists
+    //
+    for (int r = 0; r < 3; r++) {
+        cycle(r);
+    }
+    printf(1, "INFO: Reused pages zeroed on demand. \tOkay.\n");
+
+    //
+    // Pages freed and then left alone while the CPU idles, so that
+    // they can come from the pre-zeroed pool
+    //
+    for (int r = 3; r < 6; r++) {
+        sleep(20);
+        cycle(r);
+    }
+    printf(1, "INFO: Reused pages zeroed in idle time. \tOkay.\n");
+
+    //
+    // sbrk takes the zeroed pages too
+    //
+    char *heap = sbrk(NPAGES * PGSIZE);
+    if (heap == (char *)-1) {
+        printerr("sbrk() failed\n");
+        failed();
+    }
+    for (int k = 0; k < NPAGES * PGSIZE; k++) {
+        if (heap[k] != 0) {
+            printerr("heap byte %d is %d\n", k, heap[k]);
+            failed();
+        }
+    }
+    printf(1, "INFO: Grown heap zeroed. \tOkay.\n");
+
+    success();
+}
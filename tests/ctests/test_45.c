@@ -0,0 +1,113 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_45
+// Summary: BUDDY: Pages freed one at a time coalesce back into a 4MB block
+// ====================================================================
+
+char *test_name = "TEST_45";
+
+#define HUGEPAGES 1024
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    // nothing may swap or collapse pages behind the test's back
+    int thp = vmtune(VM_THP_INTERVAL, 0);
+    int low = vmtune(VM_SWAP_LOW, 0);
+    if (thp < 0 || low < 0) {
+        printerr("vmtune() read thp interval %d, swap low %d\n", thp, low);
+        failed();
+    }
+
+    //
+    // Take all but a huge page's worth of free memory, a page at a
+    // time, so that no 4MB block is left free
+    //
+    struct meminfo before;
+    meminfo(&before);
+    int n_pages = before.free_pages - HUGEPAGES;
+    uint map = wmap(MMAPBASE, n_pages * PGSIZE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    char *arr = (char *)map;
+    for (int i = 0; i < n_pages; i++) {
+        arr[i * PGSIZE] = 1;
+    }
+    struct meminfo during;
+    meminfo(&during);
+    if (during.free_pages >= HUGEPAGES) {
+        printerr("free_pages = %d with the map in, expected under %d\n",
+                 during.free_pages, HUGEPAGES);
+        failed();
+    }
+    printf(1, "INFO: Touched %d pages, %d left free. \tOkay.\n", n_pages,
+           during.free_pages);
+
+    //
+    // Freeing them must rebuild 4MB blocks
+    //
+    if (wunmap(map) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    struct meminfo after;
+    meminfo(&after);
+    // allow a few pages taken meanwhile by the memory daemons
+    if (after.free_pages < before.free_pages - 16) {
+        printerr("free_pages = %d after unmapping, %d before\n", after.free_pages,
+                 before.free_pages);
+        failed();
+    }
+
+    //
+    // so that khugepaged finds one to collapse a 4MB span into
+    //
+    map = wmap(MMAPBASE, HUGEPAGES * PGSIZE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS,
+               -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    arr = (char *)map;
+    for (int i = 0; i < HUGEPAGES; i++) {
+        arr[i * PGSIZE] = i % 100;
+    }
+    vmtune(VM_THP_INTERVAL, 2);
+    sleep(50);
+    vmtune(VM_THP_INTERVAL, thp);
+    vmtune(VM_SWAP_LOW, low);
+
+    struct pmeminfo pm;
+    if (pmeminfo(0, &pm) != SUCCESS) {
+        printerr("pmeminfo() failed\n");
+        failed();
+    }
+    if (pm.huge != 1) {
+        printerr("pmeminfo() reports %d huge pages, expected 1\n", pm.huge);
+        failed();
+    }
+    uint base = va2pa(map);
+    if (base % (HUGEPAGES * PGSIZE) != 0) {
+        printerr("huge page at 0x%x is not 4MB-aligned\n", base);
+        failed();
+    }
+    for (int i = 0; i < HUGEPAGES; i++) {
+        if (arr[i * PGSIZE] != i % 100) {
+            printerr("page %d = %d, expected %d\n", i, arr[i * PGSIZE], i % 100);
+            failed();
+        }
+    }
+    printf(1, "INFO: Freed pages coalesced into a 4MB block at 0x%x. \tOkay.\n", base);
+
+    if (wunmap(map) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+
+    success();
+}
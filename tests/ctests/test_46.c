@@ -0,0 +1,121 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_46
+// Summary: SLAB: Pipes share slab pages, carry data intact and are freed on close
+// ====================================================================
+
+char *test_name = "TEST_46";
+
+#define NPIPES 6
+#define NBYTES (64 * 1024)
+#define CYCLES 200
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    //
+    // Several pipes open at once fit in fewer pages than pipes
+    //
+    int fds[NPIPES][2];
+    for (int i = 0; i < NPIPES; i++) {
+        if (pipe(fds[i]) < 0) {
+            printerr("pipe() %d failed\n", i);
+            failed();
+        }
+    }
+    struct meminfo mi;
+    meminfo(&mi);
+    if (mi.pipe_pages <= 0 || mi.pipe_pages >= NPIPES) {
+        printerr("pipe_pages = %d with %d pipes open\n", mi.pipe_pages, NPIPES);
+        failed();
+    }
+    printf(1, "INFO: %d pipes in %d pages. \tOkay.\n", NPIPES, mi.pipe_pages);
+
+    //
+    // Data goes through each of them intact
+    //
+    for (int i = 0; i < NPIPES; i++) {
+        int pid = fork();
+        if (pid < 0) {
+            printerr("fork() failed\n");
+            failed();
+        }
+        if (pid == 0) {
+            char buf[512];
+            close(fds[i][0]);
+            for (int off = 0; off < NBYTES; off += sizeof(buf)) {
+                for (int k = 0; k < sizeof(buf); k++) {
+                    buf[k] = (off + k + i) % 251;
+                }
+                if (write(fds[i][1], buf, sizeof(buf)) != sizeof(buf)) {
+                    printerr("child %d: write failed\n", i);
+                    exit();
+                }
+            }
+            exit();
+        }
+        close(fds[i][1]);
+        int total = 0, n;
+        char buf[300];
+        while ((n = read(fds[i][0], buf, sizeof(buf))) > 0) {
+            for (int k = 0; k < n; k++) {
+                if (buf[k] != (char)((total + k + i) % 251)) {
+                    printerr("pipe %d: byte %d = %d\n", i, total + k, buf[k]);
+                    failed();
+                }
+            }
+            total += n;
+        }
+        wait();
+        if (total != NBYTES) {
+            printerr("pipe %d carried %d bytes, expected %d\n", i, total, NBYTES);
+            failed();
+        }
+    }
+    printf(1, "INFO: %d bytes through each pipe. \tOkay.\n", NBYTES);
+
+    //
+    // With its reader gone, a pipe refuses writes
+    //
+    int p[2];
+    if (pipe(p) < 0) {
+        printerr("pipe() failed\n");
+        failed();
+    }
+    close(p[0]);
+    if (write(p[1], "x", 1) != -1) {
+        printerr("write() to a pipe without a reader succeeded\n");
+        failed();
+    }
+    close(p[1]);
+    for (int i = 0; i < NPIPES; i++) {
+        close(fds[i][0]);
+    }
+
+    //
+    // Opening and closing pipes over and over doesn't leak slab pages
+    //
+    struct meminfo before;
+    meminfo(&before);
+    for (int c = 0; c < CYCLES; c++) {
+        if (pipe(p) < 0) {
+            printerr("pipe() failed in cycle %d\n", c);
+            failed();
+        }
+        close(p[0]);
+        close(p[1]);
+    }
+    struct meminfo after;
+    meminfo(&after);
+    if (after.pipe_pages > before.pipe_pages + 1) {
+        printerr("pipe_pages = %d after %d cycles, was %d\n", after.pipe_pages, CYCLES,
+                 before.pipe_pages);
+        failed();
+    }
+    printf(1, "INFO: pipe_pages %d after %d open/close cycles. \tOkay.\n",
+           after.pipe_pages, CYCLES);
+
+    success();
+}
@@ -0,0 +1,88 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_47
+// Summary: KALLOC: Memory untouched since boot is handed out zeroed, each page once
+// ====================================================================
+
+char *test_name = "TEST_47";
+
+#define SPARE 2048 // pages left free for the kernel
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    struct meminfo before;
+    if (meminfo(&before) != SUCCESS) {
+        printerr("meminfo() failed\n");
+        failed();
+    }
+    if (before.free_pages <= SPARE || before.free_pages > before.total_pages) {
+        printerr("free_pages = %d, total_pages = %d\n", before.free_pages,
+                 before.total_pages);
+        failed();
+    }
+
+    // nothing may swap or move pages behind the test's back
+    int thp = vmtune(VM_THP_INTERVAL, 0);
+    int low = vmtune(VM_SWAP_LOW, 0);
+
+    //
+    // Nearly all free memory, most of it never written since boot:
+    // every page must read as zeroes and be a page of its own
+    //
+    int n_pages = before.free_pages - SPARE;
+    uint map = wmap(MMAPBASE, n_pages * PGSIZE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    int last = PGSIZE / sizeof(int) - 1;
+    for (int i = 0; i < n_pages; i++) {
+        int *p = (int *)(map + i * PGSIZE);
+        if (p[0] != 0 || p[last / 2] != 0 || p[last] != 0) {
+            printerr("page %d is not zeroed\n", i);
+            failed();
+        }
+        p[0] = p[last] = i;
+    }
+    for (int i = 0; i < n_pages; i++) {
+        int *p = (int *)(map + i * PGSIZE);
+        if (p[0] != i || p[last] != i) {
+            printerr("page %d holds %d, expected %d\n", i, p[0], i);
+            failed();
+        }
+    }
+    struct meminfo during;
+    meminfo(&during);
+    if (during.free_pages > before.free_pages - n_pages) {
+        printerr("free_pages = %d with %d pages in use, was %d\n", during.free_pages,
+                 n_pages, before.free_pages);
+        failed();
+    }
+    printf(1, "INFO: %d of %d pages handed out zeroed and distinct. \tOkay.\n", n_pages,
+           before.total_pages);
+
+    //
+    // And they all go back
+    //
+    if (wunmap(map) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    vmtune(VM_THP_INTERVAL, thp);
+    vmtune(VM_SWAP_LOW, low);
+    struct meminfo after;
+    meminfo(&after);
+    // allow a few pages taken meanwhile by the memory daemons
+    if (after.free_pages < before.free_pages - 16) {
+        printerr("free_pages = %d after unmapping, %d before\n", after.free_pages,
+                 before.free_pages);
+        failed();
+    }
+    printf(1, "INFO: %d pages free again. \tOkay.\n", after.free_pages);
+
+    success();
+}
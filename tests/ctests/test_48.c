@@ -0,0 +1,105 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_48
+// Summary: MMLOCK: Parent and children fault on shared pages at once without mixing data
+// ====================================================================
+
+char *test_name = "TEST_48";
+
+#define NPAGES 2048
+#define ROUNDS 4
+
+// Each page's first word is (who << 16) | page, for the last writer who.
+void fill(uint map, int who) {
+    for (int j = 0; j < NPAGES; j++) {
+        *(int *)(map + j * PGSIZE) = (who << 16) | j;
+    }
+}
+
+int check(uint map, int who) {
+    for (int j = 0; j < NPAGES; j++) {
+        int v = *(int *)(map + j * PGSIZE);
+        if (v != ((who << 16) | j)) {
+            printerr("pid %d: page %d holds 0x%x, expected 0x%x\n", getpid(), j, v,
+                     (who << 16) | j);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    uint map = wmap(MMAPBASE, NPAGES * PGSIZE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1);
+    if (map != MMAPBASE) {
+        printerr("wmap() returned %d\n", (int)map);
+        failed();
+    }
+    fill(map, 0);
+
+    int fds[2];
+    if (pipe(fds) < 0) {
+        printerr("pipe() failed\n");
+        failed();
+    }
+
+    //
+    // Each round forks while the previous child may still be breaking
+    // copy-on-write pages, then both sides rewrite every page at once
+    //
+    for (int r = 1; r <= ROUNDS; r++) {
+        int pid = fork();
+        if (pid < 0) {
+            printerr("fork() failed\n");
+            failed();
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            if (check(map, r - 1) < 0) {
+                exit();
+            }
+            fill(map, 100 + r);
+            if (check(map, 100 + r) < 0) {
+                exit();
+            }
+            char c = 'a' + r;
+            write(fds[1], &c, 1);
+            exit();
+        }
+        fill(map, r);
+        if (check(map, r) < 0) {
+            failed();
+        }
+    }
+    close(fds[1]);
+
+    int n = 0;
+    char c;
+    while (read(fds[0], &c, 1) == 1) {
+        n++;
+    }
+    close(fds[0]);
+    for (int r = 0; r < ROUNDS; r++) {
+        wait();
+    }
+    if (n != ROUNDS) {
+        printerr("%d of %d children saw the right pages\n", n, ROUNDS);
+        failed();
+    }
+    if (check(map, ROUNDS) < 0) {
+        failed();
+    }
+    printf(1, "INFO: %d forks of %d pages, each side kept its own data. \tOkay.\n",
+           ROUNDS, NPAGES);
+
+    if (wunmap(map) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+
+    success();
+}
@@ -0,0 +1,91 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_49
+// Summary: WAIT: Children with big address spaces are reaped once each and freed
+// ====================================================================
+
+char *test_name = "TEST_49";
+
+#define NCHILD 8
+#define NPAGES 1024
+
+int main() {
+    printf(1, "\n\n%s\n", test_name);
+    validate_initial_state();
+
+    struct meminfo before;
+    if (meminfo(&before) != SUCCESS) {
+        printerr("meminfo() failed\n");
+        failed();
+    }
+
+    //
+    // Children grow a heap and a map, then exit with both in place
+    //
+    int pids[NCHILD];
+    for (int i = 0; i < NCHILD; i++) {
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            printerr("fork() failed\n");
+            failed();
+        }
+        if (pids[i] == 0) {
+            char *heap = sbrk(NPAGES * PGSIZE);
+            uint map = wmap(MMAPBASE, NPAGES * PGSIZE,
+                            MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1);
+            if (heap == (char *)-1 || map != MMAPBASE) {
+                printerr("child %d: sbrk() or wmap() failed\n", i);
+                exit();
+            }
+            for (int j = 0; j < NPAGES; j++) {
+                heap[j * PGSIZE] = i;
+                *(char *)(map + j * PGSIZE) = i;
+            }
+            sleep(i);
+            exit();
+        }
+    }
+
+    //
+    // wait() returns each of them exactly once, then -1
+    //
+    int seen[NCHILD] = {0};
+    for (int k = 0; k < NCHILD; k++) {
+        int pid = wait();
+        int i;
+        for (i = 0; i < NCHILD && pids[i] != pid; i++)
+            ;
+        if (i == NCHILD || seen[i]) {
+            printerr("wait() returned %d\n", pid);
+            failed();
+        }
+        seen[i] = 1;
+        struct pmeminfo pm;
+        if (pmeminfo(pid, &pm) == SUCCESS) {
+            printerr("pmeminfo(%d) still finds the reaped child\n", pid);
+            failed();
+        }
+    }
+    if (wait() != -1) {
+        printerr("wait() with no children left did not return -1\n");
+        failed();
+    }
+    printf(1, "INFO: %d children reaped once each. \tOkay.\n", NCHILD);
+
+    //
+    // and their memory is all back by the time wait() returns
+    //
+    struct meminfo after;
+    meminfo(&after);
+    // allow a few pages taken meanwhile by the memory daemons
+    if (after.free_pages < before.free_pages - 16) {
+        printerr("free_pages = %d after reaping, %d before\n", after.free_pages,
+                 before.free_pages);
+        failed();
+    }
+    printf(1, "INFO: %d pages free after, %d before. \tOkay.\n", after.free_pages,
+           before.free_pages);
+
+    success();
+}
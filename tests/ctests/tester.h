@@ -13,7 +13,8 @@
 #define MMAPBASE 0x60000000
 #define KERNBASE 0x80000000
 #define KERNCODE 0x100000
-#define PHYSTOP 0xE000000 // Top physical memory
+#define PHYSTOP 0x20000000 // Top physical memory (qemu -m 512)
+#define OLDPHYSTOP 0xE000000 // the fixed top the kernel used before sizing memory
 #define PGSIZE 0x1000
 #define TRUE 1
 #define FALSE 0
@@ -279,6 +279,270 @@ class test25(Xv6Test):
     failure_pattern = "Segmentation Fault"
 
 
+class test26(Xv6Test):
+    name = "test_26"
+    description = "MEMINFO: free and per-process page counts follow a map's lifetime"
+    tester = "ctests/test_26.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test27(Xv6Test):
+    name = "test_27"
+    description = "OFFSET: Map a window in the middle of a file and write it back"
+    tester = "ctests/test_27.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test28(Xv6Test):
+    name = "test_28"
+    description = "PRIVATE: Writes to a MAP_PRIVATE map reach neither the file nor a forked child"
+    tester = "ctests/test_28.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test29(Xv6Test):
+    name = "test_29"
+    description = "SHM: A named shared-memory object opened twice maps the same pages"
+    tester = "ctests/test_29.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test30(Xv6Test):
+    name = "test_30"
+    description = "FLUSH: Dirty pages of a mapped file reach the file before wunmap"
+    tester = "ctests/test_30.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test31(Xv6Test):
+    name = "test_31"
+    description = "SWAP: Cold anonymous pages are swapped to zram and fault back intact"
+    tester = "ctests/test_31.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test32(Xv6Test):
+    name = "test_32"
+    description = "KSM: Identical private pages are merged and split again on write"
+    tester = "ctests/test_32.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test33(Xv6Test):
+    name = "test_33"
+    description = "THP: A full 4MB anonymous span becomes one huge page, split by fork"
+    tester = "ctests/test_33.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test34(Xv6Test):
+    name = "test_34"
+    description = "FAULTSTAT: Page faults are counted by type per process and in total"
+    tester = "ctests/test_34.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test35(Xv6Test):
+    name = "test_35"
+    description = "FAULTAROUND: A sequential fill maps anonymous pages in batches"
+    tester = "ctests/test_35.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test36(Xv6Test):
+    name = "test_36"
+    description = "WPROTECT: A write to a page made read-only causes a Segmentation Fault"
+    tester = "ctests/test_36.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "Segmentation Fault"
+    failure_pattern = "PASSED"
+
+
+class test37(Xv6Test):
+    name = "test_37"
+    description = "UFFD: A child process supplies the pages of its parent's map"
+    tester = "ctests/test_37.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test38(Xv6Test):
+    name = "test_38"
+    description = "IDLE: kidled counts the pages of a map touched between scans"
+    tester = "ctests/test_38.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test39(Xv6Test):
+    name = "test_39"
+    description = "CHECKPOINT: A process restored from a checkpoint has its old memory and files"
+    tester = "ctests/test_39.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test40(Xv6Test):
+    name = "test_40"
+    description = "ZYGOTE: Children spawned from a template get fresh memory, argv and fds"
+    tester = "ctests/test_40.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test41(Xv6Test):
+    name = "test_41"
+    description = "SCHED: Children queued on the forking CPU are stolen by the idle one"
+    tester = "ctests/test_41.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=2"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test42(Xv6Test):
+    name = "test_42"
+    description = "MEMINFO: All memory the BIOS reports is used, not just the first 224MB"
+    tester = "ctests/test_42.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test43(Xv6Test):
+    name = "test_43"
+    description = "KALLOC: Children on two CPUs allocate and free pages without losing any"
+    tester = "ctests/test_43.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=2"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test44(Xv6Test):
+    name = "test_44"
+    description = "KALLOC: Pages freed with data in them come back zeroed, pool or not"
+    tester = "ctests/test_44.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test45(Xv6Test):
+    name = "test_45"
+    description = "BUDDY: Pages freed one at a time coalesce back into a 4MB block"
+    tester = "ctests/test_45.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test46(Xv6Test):
+    name = "test_46"
+    description = "SLAB: Pipes share slab pages, carry data intact and are freed on close"
+    tester = "ctests/test_46.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test47(Xv6Test):
+    name = "test_47"
+    description = "KALLOC: Memory untouched since boot is handed out zeroed, each page once"
+    tester = "ctests/test_47.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test48(Xv6Test):
+    name = "test_48"
+    description = "MMLOCK: Parent and children fault on shared pages at once without mixing data"
+    tester = "ctests/test_48.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=2"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test49(Xv6Test):
+    name = "test_49"
+    description = "WAIT: Children with big address spaces are reaped once each and freed"
+    tester = "ctests/test_49.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=2"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
 from testing.runtests import main
 
 main(
@@ -309,6 +573,30 @@ main(
         test23,
         test24,
         test25,
+        test26,
+        test27,
+        test28,
+        test29,
+        test30,
+        test31,
+        test32,
+        test33,
+        test34,
+        test35,
+        test36,
+        test37,
+        test38,
+        test39,
+        test40,
+        test41,
+        test42,
+        test43,
+        test44,
+        test45,
+        test46,
+        test47,
+        test48,
+        test49,
     ],
     # Add your test groups here
     # End of test groups
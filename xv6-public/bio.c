@@ -25,6 +25,7 @@
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
+#include "mmu.h"
 
 struct {
   struct spinlock lock;
@@ -92,6 +93,13 @@ bget(uint dev, uint blockno)
   panic("bget: no buffers");
 }
 
+// Pages taken by the buffer cache, for meminfo.
+int
+bcachepages(void)
+{
+  return PGROUNDUP(sizeof(bcache)) / PGSIZE;
+}
+
 // Return a locked buf with the contents of the indicated block.
 struct buf*
 bread(uint dev, uint blockno)
@@ -0,0 +1,451 @@
+// Checkpoint and restore of a process.
+//
+// checkpoint(path) saves the calling process to a file: its registers,
+// name, current directory and open files, its memory below sz, and
+// its wmap regions. restore(path) replaces the calling process with
+// the saved one, much as exec replaces it with a program, and returns
+// into it from its checkpoint call: checkpoint returns 0 when it saves
+// and 1 when a restore comes back through it.
+//
+// The file holds one page of metadata (struct ckpthdr, then a flag
+// byte per image page: whether PTE_U was set and whether the page
+// was writable), the image pages, the pages of every region that is
+// saved, and last the regions' wprotect bitmaps.
+//
+// The image is read back at once. A saved region comes back as a
+// MAP_PRIVATE map of its pages in the checkpoint file, so it is
+// faulted in lazily like any private file map, and writes to it never
+// reach the file. A MAP_SHARED file region is mapped from its file
+// again. Files are found by inode number, so they must still exist at
+// restore; descriptors that aren't files (pipes, shared-memory objects)
+// come back closed. Regions of shared-memory objects or uffds can't be
+// saved.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "elf.h"
+#include "stat.h"
+#include "fs.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "file.h"
+
+#define CKPTMAGIC 0x54504b43    // "CKPT"
+#define CKPTUSER  0x1           // image page flag: PTE_U is set
+#define CKPTWRITE 0x2           // image page flag: writable, perhaps
+                                // copy-on-write
+
+struct ckptfile {
+  uint inum;                    // 0 if the descriptor isn't saved
+  uint off;
+  char readable;
+  char writable;
+};
+
+struct ckptregion {
+  uint start;
+  int length;
+  int flags;
+  int fd;
+  uint inum;                    // file of a MAP_SHARED region, or 0
+  uint off;                     // offset in that file, or of the saved pages
+  char readable;
+  char writable;
+  uint protoff;                 // offset of the wprotect bitmap, or 0
+};
+
+struct ckpthdr {
+  uint magic;
+  uint sz;
+  struct trapframe tf;
+  char name[16];
+  uint cwd;
+  struct ckptfile file[NOFILE];
+  int nregion;
+  struct ckptregion region[MAX_WMMAP_INFO];
+};
+
+#define CKPTMAXPAGES (PGSIZE - sizeof(struct ckpthdr))
+
+pte_t *walkpgdir(pde_t *pgdir, const void *va, int alloc);
+
+// Copy the page at va of p into buf. Returns the flags of its entry,
+// or 0 if nothing is there. Daemons may replace p's pages while p
+// sleeps, so the copy is taken under mmlock.
+static uint
+savepage(struct proc *p, uint va, char *buf)
+{
+  pde_t pde;
+  pte_t *pte;
+  uint flags;
+
+  acquire(&p->mmlock);
+  pde = p->pgdir[PDX(va)];
+  flags = 0;
+  if(pde & PTE_PS){
+    memmove(buf, P2V(PTE_ADDR(pde) + (va & (HUGEPGSIZE-1))), PGSIZE);
+    flags = PTE_FLAGS(pde);
+  } else if((pte = walkpgdir(p->pgdir, (void*)va, 0)) != 0 && (*pte & PTE_P)){
+    memmove(buf, P2V(PTE_ADDR(*pte)), PGSIZE);
+    flags = PTE_FLAGS(*pte);
+  } else if(pte && (*pte & PTE_SWAP)){
+    zramload(PTE_SWAPSLOT(*pte), buf);
+    flags = PTE_FLAGS(*pte);
+  }
+  release(&p->mmlock);
+  return flags;
+}
+
+// Save the calling process to f, a file open for writing.
+int
+checkpoint(struct file *f)
+{
+  struct proc *p = myproc();
+  struct ckpthdr *h;
+  struct ckptregion *cr;
+  struct mmap_region *r;
+  struct file *of;
+  char *meta, *buf;
+  uchar *pgflag;
+  uint off, va, pgoff, flags;
+  int i, k, n;
+
+  meta = kalloc_zeroed();
+  buf = kalloc();
+  if(meta == 0 || buf == 0 || PGROUNDUP(p->sz) / PGSIZE > CKPTMAXPAGES)
+    goto bad;
+  h = (struct ckpthdr*)meta;
+  pgflag = (uchar*)(h + 1);
+
+  h->magic = CKPTMAGIC;
+  h->sz = p->sz;
+  h->tf = *p->tf;
+  safestrcpy(h->name, p->name, sizeof(h->name));
+  h->cwd = p->cwd->inum;
+  for(i = 0; i < NOFILE; i++){
+    if((of = p->ofile[i]) == 0 || of->type != FD_INODE)
+      continue;
+    h->file[i].inum = of->ip->inum;
+    h->file[i].off = of->off;
+    h->file[i].readable = of->readable;
+    h->file[i].writable = of->writable;
+  }
+
+  // lay out the file. only p itself changes its regions, so they
+  // can be read without mmlock.
+  off = PGSIZE + PGROUNDUP(p->sz);
+  h->nregion = p->num_mmaps;
+  for(k = 0; k < p->num_mmaps; k++){
+    r = &p->mmaps[k];
+    cr = &h->region[k];
+    if(r->uffd || (r->f && r->f->type != FD_INODE))
+      goto bad;
+    cr->start = r->start_addr;
+    cr->length = r->length;
+    cr->flags = r->flags;
+    cr->fd = r->fd;
+    if(r->f && (r->flags & MAP_SHARED)){
+      cr->inum = r->f->ip->inum;
+      cr->off = r->offset;
+      cr->readable = r->f->readable;
+      cr->writable = r->f->writable;
+    } else {
+      cr->off = off;
+      off += PGROUNDUP(r->length);
+    }
+  }
+  for(k = 0; k < p->num_mmaps; k++){
+    if(p->mmaps[k].rdonly){
+      h->region[k].protoff = off;
+      off += (PGROUNDUP(p->mmaps[k].length) / PGSIZE + 7) / 8;
+    }
+  }
+
+  // the metadata page goes first, so that the file can grow past it,
+  // and again at the end with the image page flags filled in
+  if(filewriteat(f, meta, 0, PGSIZE) != PGSIZE)
+    goto bad;
+  for(va = 0; va < p->sz; va += PGSIZE){
+    flags = savepage(p, va, buf);
+    if(flags & PTE_U)
+      pgflag[va / PGSIZE] = CKPTUSER;
+    else
+      memset(buf, 0, PGSIZE);
+    if(flags & (PTE_W|PTE_COW))
+      pgflag[va / PGSIZE] |= CKPTWRITE;
+    if(filewriteat(f, buf, PGSIZE + va, PGSIZE) != PGSIZE)
+      goto bad;
+  }
+
+  for(k = 0; k < p->num_mmaps; k++){
+    r = &p->mmaps[k];
+    cr = &h->region[k];
+    if(cr->inum)
+      continue;
+    for(pgoff = 0; pgoff < r->length; pgoff += PGSIZE){
+      if(savepage(p, r->start_addr + pgoff, buf) == 0){
+        // not faulted in yet: what the fault would have found
+        memset(buf, 0, PGSIZE);
+        if(r->f){
+          n = r->length - pgoff < PGSIZE ? r->length - pgoff : PGSIZE;
+          ilock(r->f->ip);
+          readi(r->f->ip, buf, r->offset + pgoff, n);
+          iunlock(r->f->ip);
+        }
+      }
+      if(filewriteat(f, buf, cr->off + pgoff, PGSIZE) != PGSIZE)
+        goto bad;
+    }
+  }
+  for(k = 0; k < p->num_mmaps; k++){
+    r = &p->mmaps[k];
+    n = (PGROUNDUP(r->length) / PGSIZE + 7) / 8;
+    if(r->rdonly && filewriteat(f, (char*)r->rdonly, h->region[k].protoff, n) != n)
+      goto bad;
+  }
+
+  if(filewriteat(f, meta, 0, PGSIZE) != PGSIZE)
+    goto bad;
+  kfree(meta);
+  kfree(buf);
+  return 0;
+
+ bad:
+  if(meta)
+    kfree(meta);
+  if(buf)
+    kfree(buf);
+  return -1;
+}
+
+// Whether h describes a process that can be restored from a file of
+// size bytes.
+static int
+validhdr(struct ckpthdr *h, uint size)
+{
+  struct ckptregion *cr, *cr2;
+  int k;
+
+  // the image must stay below the wmap area
+  if(h->magic != CKPTMAGIC || h->sz == 0 || h->sz > 0x60000000 ||
+     PGROUNDUP(h->sz) / PGSIZE > CKPTMAXPAGES ||
+     PGSIZE + PGROUNDUP(h->sz) > size ||
+     h->nregion < 0 || h->nregion > MAX_WMMAP_INFO)
+    return 0;
+  for(k = 0; k < h->nregion; k++){
+    cr = &h->region[k];
+    if(cr->start % PGSIZE || cr->start < 0x60000000 || cr->length <= 0 ||
+       cr->start + cr->length > 0x80000000 || cr->start + cr->length < cr->start ||
+       cr->off % PGSIZE || (cr->flags & MAP_UFFD) ||
+       !(cr->flags & MAP_SHARED) == !(cr->flags & MAP_PRIVATE))
+      return 0;
+    if(cr->inum == 0 && (cr->off + PGROUNDUP(cr->length) > size ||
+                         cr->off + PGROUNDUP(cr->length) < cr->off))
+      return 0;
+    if(cr->protoff && (cr->protoff > size ||
+                       (PGROUNDUP(cr->length) / PGSIZE + 7) / 8 > size - cr->protoff))
+      return 0;
+    for(cr2 = h->region; cr2 < cr; cr2++)
+      if(cr->start < cr2->start + PGROUNDUP(cr2->length) &&
+         cr2->start < cr->start + PGROUNDUP(cr->length))
+        return 0;
+  }
+  return 1;
+}
+
+// A file for inode inum, or 0 if there is no such inode any more.
+// The modes come from the checkpoint file, so they get open's checks:
+// a directory can't be opened for writing.
+static struct file*
+openinum(uint inum, int readable, int writable)
+{
+  struct inode *ip;
+  struct file *f;
+
+  if((ip = inumget(inum)) == 0)
+    return 0;
+  ilock(ip);
+  if(ip->type == 0 || (ip->type == T_DIR && writable) ||
+     (f = filealloc()) == 0){
+    iunlock(ip);
+    begin_op();
+    iput(ip);
+    end_op();
+    return 0;
+  }
+  iunlock(ip);
+  f->type = FD_INODE;
+  f->ip = ip;
+  f->off = 0;
+  f->readable = readable != 0;
+  f->writable = writable != 0;
+  return f;
+}
+
+// Replace the calling process with the one saved in path. Returns 1
+// into the restored process, or -1 with the caller unchanged.
+int
+restore(char *path)
+{
+  struct proc *curproc = myproc();
+  struct mmap_region mmaps[MAX_WMMAP_INFO], *r;
+  struct file *ofile[NOFILE], *cf;
+  struct inode *ip, *cwd;
+  struct ckpthdr *h;
+  struct ckptregion *cr;
+  struct trapframe *tf;
+  pde_t *pgdir, *oldpgdir;
+  char *meta;
+  uchar *pgflag;
+  uint va;
+  int i, k;
+
+  if((meta = kalloc()) == 0)
+    return -1;
+  h = (struct ckpthdr*)meta;
+  pgflag = (uchar*)(h + 1);
+  pgdir = 0;
+  cf = 0;
+  cwd = 0;
+  memset(mmaps, 0, sizeof(mmaps));
+  memset(ofile, 0, sizeof(ofile));
+
+  begin_op();
+  if((ip = namei(path)) == 0){
+    end_op();
+    kfree(meta);
+    return -1;
+  }
+  ilock(ip);
+  if(readi(ip, meta, 0, PGSIZE) != PGSIZE || !validhdr(h, ip->size))
+    goto badlocked;
+
+  // the image, read in now, writable only where it was
+  if((pgdir = setupkvm()) == 0)
+    goto badlocked;
+  if(allocuvm(pgdir, 0, h->sz) == 0)
+    goto badlocked;
+  for(va = 0; va < h->sz; va += PGSIZE){
+    if(loaduvm(pgdir, (char*)va, ip, PGSIZE + va, PGSIZE,
+               (pgflag[va / PGSIZE] & CKPTWRITE) ? ELF_PROG_FLAG_WRITE : 0) < 0)
+      goto badlocked;
+    if(!(pgflag[va / PGSIZE] & CKPTUSER))
+      clearpteu(pgdir, (char*)va);
+  }
+
+  // the regions, to be faulted in later
+  for(k = 0; k < h->nregion; k++){
+    cr = &h->region[k];
+    r = &mmaps[k];
+    r->start_addr = cr->start;
+    r->length = cr->length;
+    r->fd = cr->fd;
+    r->offset = cr->off;
+    if(cr->inum)
+      r->flags = cr->flags;
+    else
+      r->flags = (cr->flags & ~(MAP_ANONYMOUS|MAP_SHARED)) | MAP_PRIVATE;
+    if(cr->protoff && protread(r, ip, cr->protoff) < 0)
+      goto badlocked;
+  }
+  if((cf = filealloc()) == 0)
+    goto badlocked;
+  cf->type = FD_INODE;
+  cf->ip = idup(ip);
+  cf->off = 0;
+  cf->readable = 1;
+  cf->writable = 0;
+  iunlockput(ip);
+  end_op();
+
+  for(k = 0; k < h->nregion; k++){
+    cr = &h->region[k];
+    if(cr->inum == 0)
+      mmaps[k].f = filedup(cf);
+    else if((mmaps[k].f = openinum(cr->inum, cr->readable, cr->writable)) == 0)
+      goto bad;
+  }
+  for(i = 0; i < NOFILE; i++){
+    if(h->file[i].inum == 0)
+      continue;
+    ofile[i] = openinum(h->file[i].inum, h->file[i].readable, h->file[i].writable);
+    if(ofile[i])
+      ofile[i]->off = h->file[i].off;
+  }
+  if((cwd = inumget(h->cwd)) == 0)
+    goto bad;
+  ilock(cwd);
+  if(cwd->type != T_DIR){
+    iunlock(cwd);
+    goto bad;
+  }
+  iunlock(cwd);
+  fileclose(cf);
+
+  // Commit to the restored process.
+  for(i = 0; i < NOFILE; i++){
+    if(curproc->ofile[i])
+      fileclose(curproc->ofile[i]);
+    curproc->ofile[i] = ofile[i];
+  }
+  while(curproc->num_mmaps > 0)
+    wunmap(curproc->mmaps[0].start_addr);
+  begin_op();
+  iput(curproc->cwd);
+  end_op();
+  curproc->cwd = cwd;
+  safestrcpy(curproc->name, h->name, sizeof(curproc->name));
+
+  acquire(&curproc->mmlock);
+  oldpgdir = curproc->pgdir;
+  curproc->pgdir = pgdir;
+  curproc->sz = h->sz;
+  memmove(curproc->mmaps, mmaps, sizeof(mmaps));
+  curproc->num_mmaps = h->nregion;
+  release(&curproc->mmlock);
+
+  // only what the program itself could have set comes from the file;
+  // the segments and flags stay the kernel's
+  tf = curproc->tf;
+  tf->edi = h->tf.edi;
+  tf->esi = h->tf.esi;
+  tf->ebp = h->tf.ebp;
+  tf->ebx = h->tf.ebx;
+  tf->edx = h->tf.edx;
+  tf->ecx = h->tf.ecx;
+  tf->eip = h->tf.eip;
+  tf->esp = h->tf.esp;
+  switchuvm(curproc);
+  freevm(oldpgdir);
+  kfree(meta);
+  return 1;
+
+ badlocked:
+  iunlockput(ip);
+  end_op();
+ bad:
+  for(k = 0; k < MAX_WMMAP_INFO; k++){
+    protfree(&mmaps[k]);
+    if(mmaps[k].f)
+      fileclose(mmaps[k].f);
+  }
+  for(i = 0; i < NOFILE; i++)
+    if(ofile[i])
+      fileclose(ofile[i]);
+  if(cwd){
+    begin_op();
+    iput(cwd);
+    end_op();
+  }
+  if(cf)
+    fileclose(cf);
+  if(pgdir)
+    freevm(pgdir);
+  kfree(meta);
+  return -1;
+}
@@ -1,21 +1,35 @@
 struct buf;
 struct context;
+struct faultstat;
 struct file;
 struct inode;
+struct kmem_cache;
+struct mmap_region;
+struct meminfo;
+struct pmeminfo;
 struct pipe;
+struct shm;
 struct proc;
 struct rtcdate;
 struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct uffd;
 struct wmapinfo;
+struct wsinfo;
+struct schedinfo;
 
 // bio.c
 void            binit(void);
 struct buf*     bread(uint, uint);
 void            brelse(struct buf*);
 void            bwrite(struct buf*);
+int             bcachepages(void);
+
+// checkpoint.c
+int             checkpoint(struct file*);
+int             restore(char*);
 
 // console.c
 void            consoleinit(void);
@@ -25,6 +39,8 @@ void            panic(char*) __attribute__((noreturn));
 
 // exec.c
 int             exec(char*, char**);
+pde_t*          loadelf(char*, uint*, uint*);
+uint            pushargv(pde_t*, uint*, char**);
 
 // file.c
 struct file*    filealloc(void);
@@ -34,6 +50,10 @@ void            fileinit(void);
 int             fileread(struct file*, char*, int n);
 int             filestat(struct file*, struct stat*);
 int             filewrite(struct file*, char*, int n);
+int             filewriteat(struct file*, char*, uint, int);
+
+// flush.c
+void            flushd(void);
 
 // fs.c
 void            readsb(int dev, struct superblock *sb);
@@ -42,6 +62,7 @@ struct inode*   dirlookup(struct inode*, char*, uint*);
 struct inode*   ialloc(uint, short);
 struct inode*   idup(struct inode*);
 void            iinit(int dev);
+struct inode*   inumget(uint);
 void            ilock(struct inode*);
 void            iput(struct inode*);
 void            iunlock(struct inode*);
@@ -54,11 +75,17 @@ int             readi(struct inode*, char*, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, char*, uint, uint);
 
+// huge.c
+void            khugepaged(void);
+
 // ide.c
 void            ideinit(void);
 void            ideintr(void);
 void            iderw(struct buf*);
 
+// idle.c
+void            kidled(void);
+
 // ioapic.c
 void            ioapicenable(int irq, int cpu);
 extern uchar    ioapicid;
@@ -66,15 +93,25 @@ void            ioapicinit(void);
 
 // kalloc.c
 char*           kalloc(void);
+char*           kalloc_zeroed(void);
+char*           kalloc_pages(int);
+int             kalloc_zeroed_batch(char**, int);
 void            kfree(char*);
+void            kfree_pages(char*, int);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
+uchar*          pageref(uint);
+extern uint     phystop;
+int             kzeroidle(void);
+int             kfreepages(void);
+int             ktotalpages(void);
 
 // kbd.c
 void            kbdintr(void);
 
 // lapic.c
 void            cmostime(struct rtcdate *r);
+uint            cmosmemsize(void);
 int             lapicid(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
@@ -82,6 +119,11 @@ void            lapicinit(void);
 void            lapicstartap(uchar, uint);
 void            microdelay(int);
 
+// ksm.c
+void            ksminit(void);
+void            ksmd(void);
+void            ksmstat(struct meminfo*);
+
 // log.c
 void            initlog(int dev);
 void            log_write(struct buf*);
@@ -99,6 +141,8 @@ void            picinit(void);
 // pipe.c
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
+void            pipeinit(void);
+int             pipepages(void);
 int             piperead(struct pipe*, char*, int);
 int             pipewrite(struct pipe*, char*, int);
 
@@ -109,19 +153,34 @@ void            exit(void);
 int             fork(void);
 int             growproc(int);
 int             kill(int);
+void            kthreadcreate(char*, void (*)(void));
+struct proc*    lockpid(int);
+struct proc*    pinproc(int);
+int             procfaultstat(int, struct faultstat*);
+int             procwsinfo(int, struct wsinfo*);
+int             procschedinfo(int, struct schedinfo*);
+int             procmeminfo(int, struct pmeminfo*);
 struct cpu*     mycpu(void);
 struct proc*    myproc();
 void            pinit(void);
 void            procdump(void);
 void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
+void            unlockmm(struct proc*);
+void            unpinproc(struct proc*);
 void            setproc(struct proc*);
+int             spawn(pde_t*, uint, uint, uint, char*);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(void);
 void            wakeup(void*);
 void            yield(void);
 
+// swap.c
+void            kswapd(void);
+int             swapin(uint*);
+void            swapfree(uint*);
+
 // swtch.S
 void            swtch(struct context**, struct context*);
 
@@ -134,6 +193,32 @@ void            release(struct spinlock*);
 void            pushcli(void);
 void            popcli(void);
 
+// shm.c
+void            shminit(void);
+int             shmopen(char*, int, struct file**);
+int             shmunlink(char*);
+void            shmclose(struct shm*);
+int             shmsize(struct shm*);
+uint            shmpage(struct shm*, uint);
+
+// uffd.c
+void            uffdinit(void);
+int             uffdopen(struct file**);
+int             uffdreg(struct uffd*);
+void            uffdunreg(struct uffd*);
+void            uffdclose(struct uffd*);
+int             uffdwait(struct uffd*, struct proc*, uint);
+int             uffdread(struct uffd*, char*, int);
+int             uffdfill(struct file*, uint, char*, int);
+
+// slab.c
+void            slabinit(void);
+void            kmem_cache_init(struct kmem_cache*, char*, uint);
+void*           kmem_cache_alloc(struct kmem_cache*);
+void            kmem_cache_free(struct kmem_cache*, void*);
+void*           kmalloc(uint);
+void            kmfree(void*);
+
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
 void            releasesleep(struct sleeplock*);
@@ -161,6 +246,7 @@ void            syscall(void);
 void            timerinit(void);
 
 // trap.c
+void            faulttotals(struct faultstat*);
 void            idtinit(void);
 extern uint     ticks;
 void            tvinit(void);
@@ -181,19 +267,43 @@ int             deallocuvm(pde_t*, uint, uint);
 void            freevm(pde_t*);
 void            inituvm(pde_t*, char*, uint);
 int             loaduvm(pde_t*, char*, struct inode*, uint, uint, int);
-pde_t*          copyuvm(pde_t*, uint, struct proc*);
+pde_t*          copyuvm(pde_t*, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
 void            clearpteu(pde_t*, char*);
-uint            wmap(uint, int, int, int);
+uint            wmap(uint, int, int, int, uint);
 int             wunmap(uint);
+int             wprotect(uint, int, int);
+int             pagewritable(struct mmap_region*, uint);
+int             protdup(struct mmap_region*);
+void            protfree(struct mmap_region*);
+int             protread(struct mmap_region*, struct inode*, uint);
 void            incr_ref_count(uint);
-void            decr_ref_count(uint);
+int             decr_ref_count(uint);
 int             get_ref_count(uint);
 uint            va2pa(uint);
 int             getwmapinfo(struct wmapinfo*);
-int             mapthepages(pde_t*, void*, uint, uint, int);
+int             collapse(struct proc*, uint);
+int             sharerange(pde_t*, pde_t*, uint, uint, int);
+int             pgtablepages(void);
+void            uvmstat(struct proc*, struct pmeminfo*);
+int             walkrange(pde_t*, uint, uint, int (*)(uint*, uint, int, void*), void*);
+uint*           findpte(pde_t*, uint);
+int             vmknob(int);
+int             vmtune(int, int);
+
+// zram.c
+void            zraminit(void);
+int             zramstore(char*);
+void            zramload(int, char*);
+void            zramfree(int);
+void            zramstat(int*, int*);
+
+// zygote.c
+void            zygoteinit(void);
+int             zygote(char*);
+int             spawn_from(int, char**);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
@@ -7,24 +7,24 @@
 #include "x86.h"
 #include "elf.h"
 
-int
-exec(char *path, char **argv)
+// Load the ELF program at path into a new page table. Returns it,
+// with the program's size in *szp and entry point in *entryp, or 0.
+pde_t*
+loadelf(char *path, uint *szp, uint *entryp)
 {
-  char *s, *last;
   int i, off;
-  uint argc, sz, sp, ustack[3+MAXARG+1];
+  uint sz;
   struct elfhdr elf;
   struct inode *ip;
   struct proghdr ph;
-  pde_t *pgdir, *oldpgdir;
-  struct proc *curproc = myproc();
+  pde_t *pgdir;
 
   begin_op();
 
   if((ip = namei(path)) == 0){
     end_op();
     cprintf("exec: fail\n");
-    return -1;
+    return 0;
   }
   ilock(ip);
   pgdir = 0;
@@ -59,23 +59,42 @@ exec(char *path, char **argv)
   }
   iunlockput(ip);
   end_op();
-  ip = 0;
+
+  *szp = sz;
+  *entryp = elf.entry;
+  return pgdir;
+
+ bad:
+  if(pgdir)
+    freevm(pgdir);
+  iunlockput(ip);
+  end_op();
+  return 0;
+}
+
+// Give the program in pgdir, of size *szp, a stack holding argv, as
+// main expects it. Updates *szp and returns the stack pointer, or 0.
+uint
+pushargv(pde_t *pgdir, uint *szp, char **argv)
+{
+  uint argc, sz, sp, ustack[3+MAXARG+1];
 
   // Allocate two pages at the next page boundary.
   // Make the first inaccessible.  Use the second as the user stack.
-  sz = PGROUNDUP(sz);
+  sz = PGROUNDUP(*szp);
   if((sz = allocuvm(pgdir, sz, sz + 2*PGSIZE)) == 0)
-    goto bad;
+    return 0;
   clearpteu(pgdir, (char*)(sz - 2*PGSIZE));
   sp = sz;
+  *szp = sz;
 
   // Push argument strings, prepare rest of stack in ustack.
   for(argc = 0; argv[argc]; argc++) {
     if(argc >= MAXARG)
-      goto bad;
+      return 0;
     sp = (sp - (strlen(argv[argc]) + 1)) & ~3;
     if(copyout(pgdir, sp, argv[argc], strlen(argv[argc]) + 1) < 0)
-      goto bad;
+      return 0;
     ustack[3+argc] = sp;
   }
   ustack[3+argc] = 0;
@@ -86,7 +105,24 @@ exec(char *path, char **argv)
 
   sp -= (3+argc+1) * 4;
   if(copyout(pgdir, sp, ustack, (3+argc+1)*4) < 0)
-    goto bad;
+    return 0;
+  return sp;
+}
+
+int
+exec(char *path, char **argv)
+{
+  char *s, *last;
+  uint sz, sp, entry;
+  pde_t *pgdir, *oldpgdir;
+  struct proc *curproc = myproc();
+
+  if((pgdir = loadelf(path, &sz, &entry)) == 0)
+    return -1;
+  if((sp = pushargv(pgdir, &sz, argv)) == 0){
+    freevm(pgdir);
+    return -1;
+  }
 
   // Save program name for debugging.
   for(last=s=path; *s; s++)
@@ -95,21 +131,14 @@ exec(char *path, char **argv)
   safestrcpy(curproc->name, last, sizeof(curproc->name));
 
   // Commit to the user image.
+  acquire(&curproc->mmlock);
   oldpgdir = curproc->pgdir;
   curproc->pgdir = pgdir;
   curproc->sz = sz;
-  curproc->tf->eip = elf.entry;  // main
+  release(&curproc->mmlock);
+  curproc->tf->eip = entry;  // main
   curproc->tf->esp = sp;
   switchuvm(curproc);
   freevm(oldpgdir);
   return 0;
-
- bad:
-  if(pgdir)
-    freevm(pgdir);
-  if(ip){
-    iunlockput(ip);
-    end_op();
-  }
-  return -1;
 }
@@ -78,6 +78,10 @@ fileclose(struct file *f)
     iput(ff.ip);
     end_op();
   }
+  else if(ff.type == FD_SHM)
+    shmclose(ff.shm);
+  else if(ff.type == FD_UFFD)
+    uffdclose(ff.uffd);
 }
 
 // Get metadata about file f.
@@ -110,9 +114,39 @@ fileread(struct file *f, char *addr, int n)
     iunlock(f->ip);
     return r;
   }
+  if(f->type == FD_UFFD)
+    return uffdread(f->uffd, addr, n);
+  if(f->type == FD_SHM)
+    return -1;
   panic("fileread");
 }
 
+// Write n bytes from kernel address src to f's inode at offset off,
+// a few blocks per log transaction as filewrite does. Used to write
+// back MAP_SHARED pages. Returns the number of bytes written.
+int
+filewriteat(struct file *f, char *src, uint off, int n)
+{
+  int i, r, n1;
+  int max = ((MAXOPBLOCKS-1-1-2) / 2) * 512;
+
+  i = 0;
+  while(i < n){
+    n1 = n - i;
+    if(n1 > max)
+      n1 = max;
+    begin_op();
+    ilock(f->ip);
+    r = writei(f->ip, src + i, off + i, n1);
+    iunlock(f->ip);
+    end_op();
+    if(r != n1)
+      break;
+    i += r;
+  }
+  return i;
+}
+
 //PAGEBREAK!
 // Write to file f.
 int
@@ -153,6 +187,8 @@ filewrite(struct file *f, char *addr, int n)
     }
     return i == n ? n : -1;
   }
+  if(f->type == FD_SHM || f->type == FD_UFFD)
+    return -1;
   panic("filewrite");
 }
 
@@ -2,12 +2,14 @@
 #define FILE_H
 
 struct file {
-  enum { FD_NONE, FD_PIPE, FD_INODE } type;
+  enum { FD_NONE, FD_PIPE, FD_INODE, FD_SHM, FD_UFFD } type;
   int ref; // reference count
   char readable;
   char writable;
   struct pipe *pipe;
   struct inode *ip;
+  struct shm *shm;
+  struct uffd *uffd;
   uint off;
 };
 
@@ -0,0 +1,160 @@
+// Background writeback of dirty MAP_SHARED file pages.
+//
+// Without it, a shared file mapping reaches the disk only when it is
+// unmapped. flushd wakes every VM_FLUSH_INTERVAL ticks and looks for
+// pages with PTE_D set in the MAP_SHARED file regions of every process.
+// A region's dirty pages are written back once the region has stayed
+// dirty for VM_DIRTY_EXPIRE ticks, or at once if more than
+// VM_DIRTY_RATIO percent of memory was dirty at the last scan.
+//
+// Pages are collected with the owner's mmlock held and off-CPU (see
+// pinproc): PTE_D is cleared, and the page and file are pinned. They
+// are then written through the log with no locks held, so a write
+// that races with the flush sets PTE_D again and is caught next time.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "fs.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "file.h"
+#include "memstat.h"
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#define FLUSHBATCH 16
+
+struct flushbatch {
+  struct mmap_region *r;  // region being collected from
+  int n;
+  struct {
+    struct file *f;
+    uint pa;
+    uint off;             // file offset
+    int len;
+  } page[FLUSHBATCH];
+};
+
+static int
+countdirty(pte_t *pte, uint va, int n, void *arg)
+{
+  int *count = arg;
+
+  for(; n > 0; n--, pte++)
+    if((*pte & (PTE_P|PTE_D)) == (PTE_P|PTE_D))
+      (*count)++;
+  return 0;
+}
+
+static int
+collectdirty(pte_t *pte, uint va, int n, void *arg)
+{
+  struct flushbatch *b = arg;
+  struct mmap_region *r = b->r;
+  uint pa, pgoff;
+
+  for(; n > 0; n--, pte++, va += PGSIZE){
+    if((*pte & (PTE_P|PTE_D)) != (PTE_P|PTE_D))
+      continue;
+    if(b->n == FLUSHBATCH)
+      return 1;
+    pa = PTE_ADDR(*pte);
+    pgoff = va - r->start_addr;
+    *pte &= ~PTE_D;
+    incr_ref_count(pa);
+    b->page[b->n].f = filedup(r->f);
+    b->page[b->n].pa = pa;
+    b->page[b->n].off = r->offset + pgoff;
+    b->page[b->n].len = min(PGSIZE, r->length - pgoff);
+    b->n++;
+  }
+  return 0;
+}
+
+static int
+flushable(struct mmap_region *r)
+{
+  return (r->flags & MAP_SHARED) && r->f && r->f->type == FD_INODE;
+}
+
+// Write back the expired dirty regions of the process in slot i.
+// Returns the number of dirty pages it had, written or not.
+static int
+flushproc(int i, int force)
+{
+  struct flushbatch b;
+  struct mmap_region *r;
+  struct proc *p;
+  int k, j, dirty, ndirty, pass;
+
+  ndirty = 0;
+  pass = 0;
+  do {
+    b.n = 0;
+    if((p = pinproc(i)) == 0)
+      break;
+    acquire(&p->mmlock);
+    for(k = 0; k < p->num_mmaps && b.n < FLUSHBATCH; k++){
+      r = &p->mmaps[k];
+      if(!flushable(r))
+        continue;
+      dirty = 0;
+      walkrange(p->pgdir, r->start_addr, r->start_addr + r->length,
+                countdirty, &dirty);
+      if(pass == 0)
+        ndirty += dirty;
+      if(dirty == 0){
+        r->dirtysince = 0;
+        continue;
+      }
+      if(r->dirtysince == 0)
+        r->dirtysince = ticks;
+      if(!force && ticks - r->dirtysince < vmknob(VM_DIRTY_EXPIRE))
+        continue;
+      b.r = r;
+      walkrange(p->pgdir, r->start_addr, r->start_addr + r->length,
+                collectdirty, &b);
+    }
+    release(&p->mmlock);
+    unpinproc(p);
+
+    for(j = 0; j < b.n; j++){
+      if(filewriteat(b.page[j].f, P2V(b.page[j].pa), b.page[j].off,
+                     b.page[j].len) != b.page[j].len)
+        cprintf("flushd: write error\n");
+      if(decr_ref_count(b.page[j].pa) == 0)
+        kfree(P2V(b.page[j].pa));
+      fileclose(b.page[j].f);
+    }
+    // a full batch may have left more behind
+    pass++;
+  } while(b.n == FLUSHBATCH);
+  return ndirty;
+}
+
+void
+flushd(void)
+{
+  uint t0;
+  int i, ndirty, force;
+
+  ndirty = 0;
+  for(;;){
+    acquire(&tickslock);
+    t0 = ticks;
+    while(ticks - t0 < vmknob(VM_FLUSH_INTERVAL))
+      sleep(&ticks, &tickslock);
+    release(&tickslock);
+
+    force = ndirty * 100 > vmknob(VM_DIRTY_RATIO) * ktotalpages();
+    ndirty = 0;
+    for(i = 0; i < NPROC; i++)
+      ndirty += flushproc(i, force);
+  }
+}
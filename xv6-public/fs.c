@@ -271,6 +271,16 @@ iget(uint dev, uint inum)
   return ip;
 }
 
+// Find inode number inum on the root device, as iget does, for
+// restoring a checkpoint. Returns 0 if there can't be such an inode.
+struct inode*
+inumget(uint inum)
+{
+  if(inum == 0 || inum >= sb.ninodes)
+    return 0;
+  return iget(ROOTDEV, inum);
+}
+
 // Increment reference count for ip.
 // Returns ip to enable ip = idup(ip1) idiom.
 struct inode*
@@ -0,0 +1,77 @@
+// Transparent huge pages.
+//
+// khugepaged wakes every VM_THP_INTERVAL ticks (0 turns it off) and
+// looks for 4MB-aligned spans of a process's heap and of its anonymous
+// wmap regions whose pages are all present and private to it. collapse
+// in vm.c copies such a span into one contiguous block and maps it
+// with a single PTE_PS entry in the page directory, so the process
+// needs one TLB entry for it instead of 1024.
+//
+// Nothing else has to know about huge pages: walkpgdir splits one back
+// into a page table when a PTE is wanted (a fault), fork splits those
+// it shares with the child before sharing them, and a partial
+// unmap or sbrk shrink splits the one it cuts through.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "memstat.h"
+
+#define HUGEBATCH 2     // spans collapsed per process and pass; each is
+                        // a 4MB copy
+
+// Collapse what can be collapsed in [start, end) of p, up to *budget
+// spans.
+static void
+collapserange(struct proc *p, uint start, uint end, int *budget)
+{
+  uint va;
+
+  va = (start + HUGEPGSIZE-1) & ~(HUGEPGSIZE-1);
+  for(; va + HUGEPGSIZE <= end && *budget > 0; va += HUGEPGSIZE)
+    if(collapse(p, va))
+      (*budget)--;
+}
+
+// p is pinned, so its size and regions can't change under the walk.
+// collapse takes p's mmlock itself, and only around checking and
+// installing a span, not around the copy.
+static void
+collapseproc(int i)
+{
+  struct mmap_region *r;
+  struct proc *p;
+  int k, budget;
+
+  if((p = pinproc(i)) == 0)
+    return;
+  budget = HUGEBATCH;
+  collapserange(p, 0, p->sz, &budget);
+  for(k = 0; k < p->num_mmaps; k++){
+    r = &p->mmaps[k];
+    if(r->flags & MAP_ANONYMOUS)
+      collapserange(p, r->start_addr, r->start_addr + r->length, &budget);
+  }
+  unpinproc(p);
+}
+
+void
+khugepaged(void)
+{
+  uint t0;
+  int i, n;
+
+  for(;;){
+    acquire(&tickslock);
+    t0 = ticks;
+    while((n = vmknob(VM_THP_INTERVAL)) == 0 || ticks - t0 < n)
+      sleep(&ticks, &tickslock);
+    release(&tickslock);
+
+    for(i = 0; i < NPROC; i++)
+      collapseproc(i);
+  }
+}
@@ -0,0 +1,113 @@
+// Working-set estimation.
+//
+// kidled wakes every VM_IDLE_INTERVAL ticks (0 turns it off) and, for
+// each process, counts the present pages of its image (below sz) and
+// of each wmap region, and how many of them have PTE_A set, that is,
+// were touched since the previous scan. It then clears PTE_A so the
+// next scan sees only new accesses. The counts of the latest scan are
+// kept in p->ws for getwsinfo.
+//
+// The hardware bit is moved into the software bit PTE_YOUNG rather
+// than dropped, so that kswapd still sees the access: it treats either
+// bit as a reference, and clears both.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "memstat.h"
+
+struct wscount {
+  int resident;
+  int touched;
+};
+
+static int
+scanfn(pte_t *pte, uint va, int n, void *arg)
+{
+  struct wscount *c = arg;
+
+  for(; n > 0; n--, pte++){
+    if(!(*pte & PTE_P))
+      continue;
+    c->resident++;
+    if(*pte & PTE_A){
+      c->touched++;
+      *pte = (*pte & ~PTE_A) | PTE_YOUNG;
+    }
+  }
+  return 0;
+}
+
+// Count and clear the accessed pages in [start, end) of pgdir,
+// including those of huge pages, which walkrange skips.
+static void
+scanrange(pde_t *pgdir, uint start, uint end, struct wscount *c)
+{
+  pde_t *pde;
+  uint va;
+
+  c->resident = c->touched = 0;
+  walkrange(pgdir, start, end, scanfn, c);
+  va = (start + HUGEPGSIZE-1) & ~(HUGEPGSIZE-1);
+  for(; va + HUGEPGSIZE <= end && va < KERNBASE; va += HUGEPGSIZE){
+    pde = &pgdir[PDX(va)];
+    if(!(*pde & PTE_PS))
+      continue;
+    c->resident += NPTENTRIES;
+    if(*pde & PTE_A){
+      c->touched += NPTENTRIES;
+      *pde = (*pde & ~PTE_A) | PTE_YOUNG;
+    }
+  }
+}
+
+// Scan p and record the counts in p->ws. Caller holds p's mmlock with
+// p off-CPU (see pinproc), so the cleared bits reach its TLB.
+static void
+wsscan(struct proc *p)
+{
+  struct mmap_region *r;
+  struct wscount c;
+  int k;
+
+  scanrange(p->pgdir, 0, p->sz, &c);
+  p->ws.heap_resident = c.resident;
+  p->ws.heap_touched = c.touched;
+  for(k = 0; k < p->num_mmaps; k++){
+    r = &p->mmaps[k];
+    scanrange(p->pgdir, r->start_addr, r->start_addr + r->length, &c);
+    p->ws.addr[k] = r->start_addr;
+    p->ws.resident[k] = c.resident;
+    p->ws.touched[k] = c.touched;
+  }
+  p->ws.total_mmaps = p->num_mmaps;
+  p->ws.scans++;
+}
+
+void
+kidled(void)
+{
+  struct proc *p;
+  uint t0;
+  int i, n;
+
+  for(;;){
+    acquire(&tickslock);
+    t0 = ticks;
+    while((n = vmknob(VM_IDLE_INTERVAL)) == 0 || ticks - t0 < n)
+      sleep(&ticks, &tickslock);
+    release(&tickslock);
+
+    for(i = 0; i < NPROC; i++){
+      if((p = pinproc(i)) == 0)
+        continue;
+      acquire(&p->mmlock);
+      wsscan(p);
+      release(&p->mmlock);
+      unpinproc(p);
+    }
+  }
+}
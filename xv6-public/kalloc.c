@@ -1,6 +1,7 @@
 // Physical memory allocator, intended to allocate
 // memory for user processes, kernel stacks, page table pages,
-// and pipe buffers. Allocates 4096-byte pages.
+// and pipe buffers. Allocates 4096-byte pages, or physically
+// contiguous blocks of 2^order pages with kalloc_pages().
 
 #include "types.h"
 #include "defs.h"
@@ -10,30 +11,137 @@
 #include "spinlock.h"
 
 void freerange(void *vstart, void *vend);
+static void buddyfree(char *v, int order);
 extern char end[]; // first address after kernel loaded from ELF file
                    // defined by the kernel linker script in kernel.ld
 
 struct run {
   struct run *next;
+  struct run *prev;       // only used on the buddy free lists
 };
 
-struct {
+// Free memory is kept by a binary buddy allocator. A block of order k
+// is 2^k pages, aligned to its size in physical memory; its buddy is
+// the block whose page number differs only in bit k. Freeing a block
+// whose buddy is also free merges the two into one block of order k+1.
+// The frame table records, for the first page of every free block,
+// PG_FREE and the block's order, which is how kfree finds a free buddy.
+#define MAXORDER 10                     // 2^10 pages = 4 MB
+#define PG_FREE  0x80
+
+// One entry per physical page below phystop. kinit1 sizes the table
+// from the BIOS memory map and places it just past the kernel.
+struct frame {
+  uchar state;            // PG_FREE|order if the first page of a free block
+  uchar ref;              // user mappings of the page; see incr_ref_count
+};
+
+uint phystop;             // top of the physical memory the kernel uses
+static uint physskip;     // bytes of memory beyond the kernel's map
+static struct frame *frames;
+static uint nframes;
+
+// Per-CPU free-page cache. kalloc() and kfree() normally touch only
+// the current CPU's cache; pages move between a cache and the buddy
+// allocator KCACHEBATCH at a time, so kmem.lock is taken once per
+// batch rather than once per page. Each cache has its own lock so
+// that a CPU that runs dry can steal from the others.
+//
+// Each cache also keeps a list of pages that the CPU zeroed while it
+// had nothing to run (see kzeroidle), so kalloc_zeroed() can usually
+// skip the memset.
+#define KCACHEBATCH 16
+#define KCACHEHIGH  (4*KCACHEBATCH)
+#define KZEROHIGH   32
+#define KBATCHMAX   32    // most pages kalloc_zeroed_batch hands out at once
+
+struct kcache {
   struct spinlock lock;
-  int use_lock;
   struct run *freelist;
+  int nfree;
+  struct run *zeroed;     // pages known to be all zeroes
+  int nzeroed;
+};
+
+struct {
+  struct spinlock lock;               // protects free[], frame states, nfree
+  int use_lock;
+  struct run *free[MAXORDER+1];       // buddy free lists, by order
+  int nfree;                          // pages on the buddy free lists
+  int npages;                         // pages ever given to the allocator
+  struct kcache cpu[NCPU];
 } kmem;
 
+// An entry of the BIOS memory map that bootasm.S saves at E820MAP.
+struct e820 {
+  uint64 addr;
+  uint64 len;
+  uint type;
+};
+#define E820_RAM 1
+
+// Top of the RAM that runs unbroken up from EXTMEM, by the BIOS memory
+// map, or 0 if there is no map. Memory the map reserves, such as the
+// firmware's tables at the top of RAM, ends the run, and so does any
+// hole; the allocator wants one contiguous range.
+static uint
+e820memsize(void)
+{
+  struct e820 *map, *e, *end;
+  uint64 top, last;
+
+  map = (struct e820*)P2V(E820MAP + 4);
+  end = (struct e820*)P2V((uint)*(ushort*)P2V(E820MAP));
+  if(end <= map || end > map + (PGSIZE - 4) / sizeof(*map))
+    return 0;
+  top = EXTMEM;
+  do {
+    last = top;
+    for(e = map; e < end; e++)
+      if(e->type == E820_RAM && e->addr <= top && e->addr + e->len > top)
+        top = e->addr + e->len;
+  } while(top != last);
+  if(top == EXTMEM)
+    return 0;
+  return top > DEVSPACE ? DEVSPACE : top;
+}
+
 // Initialization happens in two phases.
-// 1. main() calls kinit1() while still using entrypgdir to place just
-// the pages mapped by entrypgdir on free list.
+// 1. main() calls kinit1() while still using entrypgdir to size
+// physical memory, carve the frame table out of the memory after
+// the kernel, and place the rest of the pages mapped by entrypgdir
+// on the free lists.
 // 2. main() calls kinit2() with the rest of the physical pages
 // after installing a full page table that maps them on all cores.
 void
 kinit1(void *vstart, void *vend)
 {
+  int i;
+  uint mem;
+
   initlock(&kmem.lock, "kmem");
+  for(i = 0; i < NCPU; i++)
+    initlock(&kmem.cpu[i].lock, "kcache");
   kmem.use_lock = 0;
 
+  // Use all of memory that fits in the kernel's direct map. CMOS
+  // gives only the amount of RAM, not which of it is free to use, so
+  // it is a fallback for a BIOS without a memory map.
+  if((mem = e820memsize()) == 0 && (mem = cmosmemsize()) == 0)
+    mem = PHYSTOP;
+  phystop = PGROUNDDOWN(mem);
+  if(phystop > PHYSMAX){
+    physskip = phystop - PHYSMAX;
+    phystop = PHYSMAX;
+  }
+
+  nframes = phystop / PGSIZE;
+  frames = (struct frame*)PGROUNDUP((uint)vstart);
+  vstart = (char*)frames + nframes * sizeof(struct frame);
+  if((char*)vstart > (char*)vend)
+    panic("kinit1: frame table");
+  memset(frames, 0, nframes * sizeof(struct frame));
+
   freerange(vstart, vend);
 }
 
@@ -42,40 +150,246 @@ kinit2(void *vstart, void *vend)
 {
   freerange(vstart, vend);
   kmem.use_lock = 1;
-
+  if(physskip)
+    cprintf("kinit2: %dMB of memory above the kernel map not used\n",
+            physskip >> 20);
 }
 
+// Hand [vstart, vend) to the buddy allocator as the largest aligned
+// blocks that fit, instead of freeing it a page at a time. Only the
+// first page of each block is written (its free-list links), so boot
+// no longer touches every page of memory; a page is first written
+// when it is allocated. Blocks are freed from the top down so that
+// the lowest addresses end up at the heads of the free lists and
+// are handed out first.
 void
 freerange(void *vstart, void *vend)
 {
-  char *p;
-  p = (char*)PGROUNDUP((uint)vstart);
-  for(; p + PGSIZE <= (char*)vend; p += PGSIZE)
-    kfree(p);
+  uint pa, epa;
+  int order;
+
+  pa = V2P(PGROUNDUP((uint)vstart));
+  epa = V2P(PGROUNDDOWN((uint)vend));
+  while(pa < epa){
+    for(order = MAXORDER; order > 0; order--)
+      if(epa % (PGSIZE << order) == 0 && epa - (PGSIZE << order) >= pa)
+        break;
+    epa -= PGSIZE << order;
+    buddyfree(P2V(epa), order);
+    kmem.npages += 1 << order;
+  }
+}
+
+static void
+buddypush(struct run *r, int order)
+{
+  r->prev = 0;
+  r->next = kmem.free[order];
+  if(r->next)
+    r->next->prev = r;
+  kmem.free[order] = r;
+  frames[V2P(r) / PGSIZE].state = PG_FREE | order;
+}
+
+static void
+buddyremove(struct run *r, int order)
+{
+  if(r->prev)
+    r->prev->next = r->next;
+  else
+    kmem.free[order] = r->next;
+  if(r->next)
+    r->next->prev = r->prev;
+  frames[V2P(r) / PGSIZE].state = 0;
+}
+
+// Return the block of 2^order pages at v to the free lists,
+// merging it with its buddy for as long as the buddy is free.
+// Caller holds kmem.lock (once use_lock is set).
+static void
+buddyfree(char *v, int order)
+{
+  uint pn, bn;
+
+  kmem.nfree += 1 << order;
+  pn = V2P(v) / PGSIZE;
+  for(; order < MAXORDER; order++){
+    bn = pn ^ (1 << order);
+    if(bn >= nframes || frames[bn].state != (PG_FREE | order))
+      break;
+    buddyremove((struct run*)P2V(bn * PGSIZE), order);
+    if(bn < pn)
+      pn = bn;
+  }
+  buddypush((struct run*)P2V(pn * PGSIZE), order);
+}
+
+// Remove a block of 2^order pages from the free lists, splitting
+// a larger block if no block of that order is free.
+// Caller holds kmem.lock (once use_lock is set).
+static char*
+buddyalloc(int order)
+{
+  struct run *r;
+  int k;
+
+  for(k = order; k <= MAXORDER; k++)
+    if(kmem.free[k])
+      break;
+  if(k > MAXORDER)
+    return 0;
+
+  r = kmem.free[k];
+  buddyremove(r, k);
+  kmem.nfree -= 1 << order;
+  // Give back the upper half at each level until the block fits.
+  while(k > order){
+    k--;
+    buddypush((struct run*)((char*)r + (PGSIZE << k)), k);
+  }
+  return (char*)r;
+}
+
+// Move up to n pages from the buddy allocator to cache c.
+// Caller holds c->lock.
+static void
+krefill(struct kcache *c, int n)
+{
+  struct run *r;
+
+  acquire(&kmem.lock);
+  while(n-- > 0 && (r = (struct run*)buddyalloc(0)) != 0){
+    r->next = c->freelist;
+    c->freelist = r;
+    c->nfree++;
+  }
+  release(&kmem.lock);
 }
+
+// Move up to n pages from cache c back to the buddy allocator.
+// Caller holds c->lock.
+static void
+kdrain(struct kcache *c, int n)
+{
+  struct run *r;
+
+  acquire(&kmem.lock);
+  while(n-- > 0 && (r = c->freelist) != 0){
+    c->freelist = r->next;
+    c->nfree--;
+    buddyfree((char*)r, 0);
+  }
+  release(&kmem.lock);
+}
+
+// Take a page off cache c, from its zeroed list if zeroed is set
+// (or if the plain list is empty) and from its plain list otherwise.
+// Sets *iszero if the page came from the zeroed list.
+// Caller holds c->lock.
+static struct run*
+kcachepop(struct kcache *c, int zeroed, int *iszero)
+{
+  struct run *r;
+
+  *iszero = 0;
+  if((zeroed || c->freelist == 0) && (r = c->zeroed) != 0){
+    c->zeroed = r->next;
+    c->nzeroed--;
+    *iszero = 1;
+    return r;
+  }
+  if((r = c->freelist) != 0){
+    c->freelist = r->next;
+    c->nfree--;
+  }
+  return r;
+}
+
+// The buddy allocator and this CPU's cache are both empty:
+// take a page from some other CPU's cache.
+static struct run*
+ksteal(struct kcache *self, int zeroed, int *iszero)
+{
+  struct kcache *c;
+  struct run *r;
+
+  for(c = kmem.cpu; c < &kmem.cpu[NCPU]; c++){
+    if(c == self)
+      continue;
+    acquire(&c->lock);
+    r = kcachepop(c, zeroed, iszero);
+    release(&c->lock);
+    if(r)
+      return r;
+  }
+  return 0;
+}
+
 //PAGEBREAK: 21
 // Free the page of physical memory pointed at by v,
-// which normally should have been returned by a
-// call to kalloc().  (The exception is when
-// initializing the allocator; see kinit above.)
+// which should have been returned by a call to kalloc()
+// (or be one page of a kalloc_pages() block).
 void
 kfree(char *v)
 {
+  struct kcache *c;
   struct run *r;
 
-  if((uint)v % PGSIZE || v < end || V2P(v) >= PHYSTOP)
+  if((uint)v % PGSIZE || v < end || V2P(v) >= phystop)
     panic("kfree");
 
+#ifdef KMEMDEBUG
   // Fill with junk to catch dangling refs.
   memset(v, 1, PGSIZE);
+#endif
+
+  if(!kmem.use_lock){
+    // Still booting on one CPU: no caches yet.
+    buddyfree(v, 0);
+    return;
+  }
 
-  if(kmem.use_lock)
-    acquire(&kmem.lock);
   r = (struct run*)v;
-  r->next = kmem.freelist;
-  kmem.freelist = r;
-  if(kmem.use_lock)
-    release(&kmem.lock);
+
+  pushcli();
+  c = &kmem.cpu[cpuid()];
+  acquire(&c->lock);
+  r->next = c->freelist;
+  c->freelist = r;
+  if(++c->nfree > KCACHEHIGH)
+    kdrain(c, KCACHEBATCH);
+  release(&c->lock);
+  popcli();
+}
+
+static char*
+kallocpage(int zeroed)
+{
+  struct kcache *c;
+  struct run *r;
+  int iszero;
+
+  if(!kmem.use_lock){
+    r = (struct run*)buddyalloc(0);
+    if(r && zeroed)
+      memset(r, 0, PGSIZE);
+    return (char*)r;
+  }
+
+  pushcli();
+  c = &kmem.cpu[cpuid()];
+  acquire(&c->lock);
+  if(c->freelist == 0 && (!zeroed || c->zeroed == 0))
+    krefill(c, KCACHEBATCH);
+  r = kcachepop(c, zeroed, &iszero);
+  release(&c->lock);
+  if(r == 0)
+    r = ksteal(c, zeroed, &iszero);
+  popcli();
+
+  if(r && zeroed && !iszero)
+    memset(r, 0, PGSIZE);
+  return (char*)r;
 }
 
 // Allocate one 4096-byte page of physical memory.
@@ -84,16 +398,174 @@ kfree(char *v)
 char*
 kalloc(void)
 {
+  return kallocpage(0);
+}
+
+// Like kalloc(), but the page is filled with zeroes.
+// Prefer this to kalloc()+memset(): the page usually comes
+// from the pool that idle CPUs zero ahead of time.
+char*
+kalloc_zeroed(void)
+{
+  return kallocpage(1);
+}
+
+// Allocate up to n zeroed pages into pages[], taking this CPU's
+// cache lock once for all of them rather than once per page. Gets
+// at most KBATCHMAX per call, and fewer if the cache and the buddy
+// allocator run dry (it doesn't steal from other CPUs). Returns
+// how many it got.
+int
+kalloc_zeroed_batch(char **pages, int n)
+{
+  struct kcache *c;
   struct run *r;
+  uchar zero[KBATCHMAX];
+  int i, j;
+
+  if(n > KBATCHMAX)
+    n = KBATCHMAX;
+  if(!kmem.use_lock){
+    for(i = 0; i < n && (pages[i] = kallocpage(1)) != 0; i++)
+      ;
+    return i;
+  }
+
+  pushcli();
+  c = &kmem.cpu[cpuid()];
+  acquire(&c->lock);
+  for(i = 0; i < n; i++){
+    if(c->freelist == 0 && c->zeroed == 0)
+      krefill(c, KCACHEBATCH);
+    r = kcachepop(c, 1, &j);
+    if(r == 0)
+      break;
+    pages[i] = (char*)r;
+    zero[i] = j;
+  }
+  release(&c->lock);
+  popcli();
+
+  for(j = 0; j < i; j++)
+    if(!zero[j])
+      memset(pages[j], 0, PGSIZE);
+  return i;
+}
+
+// Allocate 2^order physically contiguous pages, aligned to
+// their size. Returns 0 if no such block is free.
+// Free the block with kfree_pages(v, order), or page by page
+// with kfree().
+char*
+kalloc_pages(int order)
+{
+  char *v;
+
+  if(order < 0 || order > MAXORDER)
+    return 0;
+  if(order == 0)
+    return kalloc();
 
   if(kmem.use_lock)
     acquire(&kmem.lock);
-  r = kmem.freelist;
-  if(r)
-    kmem.freelist = r->next;
+  v = buddyalloc(order);
   if(kmem.use_lock)
     release(&kmem.lock);
+  return v;
+}
 
-  return (char*)r;
+// Free a block returned by kalloc_pages(order).
+void
+kfree_pages(char *v, int order)
+{
+  if(order < 0 || order > MAXORDER)
+    panic("kfree_pages: order");
+  if(order == 0){
+    kfree(v);
+    return;
+  }
+  if(V2P(v) % (PGSIZE << order) || v < end || V2P(v) >= phystop)
+    panic("kfree_pages");
+
+#ifdef KMEMDEBUG
+  memset(v, 1, PGSIZE << order);
+#endif
+
+  if(kmem.use_lock)
+    acquire(&kmem.lock);
+  buddyfree(v, order);
+  if(kmem.use_lock)
+    release(&kmem.lock);
+}
+
+// Called by scheduler() when this CPU found nothing to run.
+// Zero one free page and put it on this CPU's zeroed list.
+// Returns 1 if a page was zeroed, 0 if the pool is full
+// or there is no free memory.
+int
+kzeroidle(void)
+{
+  struct kcache *c;
+  struct run *r;
+
+  if(!kmem.use_lock)
+    return 0;
+
+  pushcli();
+  c = &kmem.cpu[cpuid()];
+  acquire(&c->lock);
+  if(c->nzeroed >= KZEROHIGH){
+    release(&c->lock);
+    popcli();
+    return 0;
+  }
+  if(c->freelist == 0)
+    krefill(c, KCACHEBATCH);
+  if((r = c->freelist) != 0){
+    c->freelist = r->next;
+    c->nfree--;
+  }
+  release(&c->lock);
+
+  if(r){
+    memset(r, 0, PGSIZE);
+    acquire(&c->lock);
+    r->next = c->zeroed;
+    c->zeroed = r;
+    c->nzeroed++;
+    release(&c->lock);
+  }
+  popcli();
+  return r != 0;
+}
+
+// Number of free pages, counting the per-CPU caches.
+// Read without locks, so only a snapshot.
+int
+kfreepages(void)
+{
+  struct kcache *c;
+  int n;
+
+  n = kmem.nfree;
+  for(c = kmem.cpu; c < &kmem.cpu[NCPU]; c++)
+    n += c->nfree + c->nzeroed;
+  return n;
 }
 
+// Number of pages the allocator manages.
+int
+ktotalpages(void)
+{
+  return kmem.npages;
+}
+
+// The reference count of the physical page at pa,
+// or 0 if pa is not memory the allocator manages.
+uchar*
+pageref(uint pa)
+{
+  if(pa >= phystop)
+    return 0;
+  return &frames[pa / PGSIZE].ref;
+}
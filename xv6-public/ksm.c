@@ -0,0 +1,322 @@
+// Same-page merging for MAP_PRIVATE wmap regions.
+//
+// ksmd wakes every VM_KSM_INTERVAL ticks (0 turns it off) and hashes
+// each private page that only one page table maps. A page equal to
+// one in the stable table is remapped onto that frame, read-only and
+// PTE_COW, and its own frame is freed; a write later breaks the
+// sharing through the ordinary copy-on-write fault. A page equal to
+// another candidate seen earlier in the same pass is itself made
+// read-only and entered in the stable table, so the other page merges
+// with it on the next pass.
+//
+// The stable table holds a reference to each of its frames. That
+// keeps every mapper's count above 1, so no mapper can take the COW
+// shortcut and write the shared frame in place. A frame that only the
+// table still references is dropped at the start of a pass.
+//
+// Pages are picked in batches under the owner's mmlock, with the owner
+// pinned (see pinproc). They are hashed and compared with no lock
+// held. Only installing a merged PTE takes mmlock and ksm.lock again,
+// and only where the PTE hasn't changed meanwhile.
+//
+// MAP_SHARED regions are left alone: a fork shares their pages
+// without COW, and a merged page there would split on the first
+// write instead of staying shared.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "memstat.h"
+
+#define NKSMSTABLE   128            // merged frames
+#define NKSMUNSTABLE 256            // candidates remembered per pass
+#define KSMMAXREF    250            // page reference counts are a uchar
+#define KSMBATCH     16             // pages picked per batch
+
+struct ksmpage {
+  uint hash;
+  uint pa;                          // 0 for an empty entry
+};
+
+static struct {
+  struct spinlock lock;             // protects everything below; ksmd,
+                                    // the only writer, reads without it
+  struct ksmpage stable[NKSMSTABLE];
+  struct ksmpage unstable[NKSMUNSTABLE];
+  int nunstable;
+  int scanned;                      // pages hashed, ever
+  int merges;                       // pages merged, ever
+} ksm;
+
+static uint
+hashpage(uint *p)
+{
+  uint h;
+  int i;
+
+  // FNV-1a over words
+  h = 2166136261U;
+  for(i = 0; i < PGSIZE / sizeof(uint); i++)
+    h = (h ^ p[i]) * 16777619U;
+  return h;
+}
+
+static int
+samepage(uint pa1, uint pa2)
+{
+  return memcmp(P2V(pa1), P2V(pa2), PGSIZE) == 0;
+}
+
+// Drop the stable frames nobody maps any more, and forget last pass's
+// candidates.
+static void
+prune(void)
+{
+  struct ksmpage *k;
+
+  acquire(&ksm.lock);
+  for(k = ksm.stable; k < &ksm.stable[NKSMSTABLE]; k++){
+    // with no mapper left, nothing can add one back
+    if(k->pa && get_ref_count(k->pa) == 1){
+      if(decr_ref_count(k->pa) == 0)
+        kfree(P2V(k->pa));
+      k->pa = 0;
+    }
+  }
+  ksm.nunstable = 0;
+  release(&ksm.lock);
+}
+
+// What to do with a candidate page, decided without the locks.
+#define KSMNONE     0   // nothing
+#define KSMMERGE    1   // share the stable frame k
+#define KSMSTABLE   2   // make it a stable frame itself
+#define KSMREMEMBER 3   // remember it as a candidate
+
+struct ksmbatch {
+  int n;
+  struct {
+    uint va;
+    uint pa;
+    uint hash;
+    int what;
+    struct ksmpage *k;
+  } page[KSMBATCH];
+};
+
+// Pick the private pages only one page table maps, taking a reference
+// to each so that it stays put until it is hashed.
+static int
+pickfn(pte_t *pte, uint va, int n, void *arg)
+{
+  struct ksmbatch *b = arg;
+  uint pa;
+
+  for(; n > 0; n--, pte++, va += PGSIZE){
+    if(!(*pte & PTE_P))
+      continue;
+    pa = PTE_ADDR(*pte);
+    if(get_ref_count(pa) != 1)
+      continue;
+    incr_ref_count(pa);
+    b->page[b->n].va = va;
+    b->page[b->n].pa = pa;
+    b->n++;
+    if(b->n == KSMBATCH)
+      return 1;
+  }
+  return 0;
+}
+
+// Hash a picked page and look for an equal one. Called with no lock
+// held: the page's owner is pinned and nobody else maps it, so it
+// doesn't change, and stable frames never do. ksmd is the only writer
+// of the tables, so it can read them without ksm.lock. Unstable
+// entries may have changed or been freed since, which only makes
+// them useless hints.
+static void
+match(struct ksmbatch *b, int j)
+{
+  struct ksmpage *k;
+  uint h, pa;
+  int i;
+
+  pa = b->page[j].pa;
+  b->page[j].hash = h = hashpage(P2V(pa));
+  b->page[j].what = KSMREMEMBER;
+
+  for(k = ksm.stable; k < &ksm.stable[NKSMSTABLE]; k++)
+    if(k->pa && k->hash == h)
+      break;
+  if(k < &ksm.stable[NKSMSTABLE]){
+    if(samepage(k->pa, pa)){
+      b->page[j].what = KSMMERGE;
+      b->page[j].k = k;
+    }
+    return;
+  }
+
+  for(i = 0; i < ksm.nunstable; i++){
+    k = &ksm.unstable[i];
+    if(k->hash == h && k->pa != pa && samepage(k->pa, pa)){
+      b->page[j].what = KSMSTABLE;
+      return;
+    }
+  }
+}
+
+// Carry out what match decided for a picked page whose PTE is pte.
+// Caller holds ksm.lock and the owner's mmlock, and has checked that
+// the PTE still maps the page and nobody else took a reference.
+static void
+mergepage(struct ksmbatch *b, int j, pte_t *pte)
+{
+  struct ksmpage *k;
+  uint pa;
+
+  pa = b->page[j].pa;
+  switch(b->page[j].what){
+  case KSMMERGE:
+    k = b->page[j].k;
+    if(k->pa == 0 || get_ref_count(k->pa) >= KSMMAXREF)
+      break;
+    incr_ref_count(k->pa);
+    *pte = k->pa | (PTE_FLAGS(*pte) & ~PTE_W) | ((*pte & PTE_W) ? PTE_COW : 0);
+    decr_ref_count(pa);
+    ksm.merges++;
+    break;
+  case KSMSTABLE:
+    for(k = ksm.stable; k < &ksm.stable[NKSMSTABLE]; k++)
+      if(k->pa == 0)
+        break;
+    if(k == &ksm.stable[NKSMSTABLE])
+      break;
+    incr_ref_count(pa);
+    if(*pte & PTE_W)
+      *pte = (*pte & ~PTE_W) | PTE_COW;
+    k->hash = b->page[j].hash;
+    k->pa = pa;
+    break;
+  case KSMREMEMBER:
+    if(ksm.nunstable < NKSMUNSTABLE){
+      ksm.unstable[ksm.nunstable].hash = b->page[j].hash;
+      ksm.unstable[ksm.nunstable].pa = pa;
+      ksm.nunstable++;
+    }
+    break;
+  }
+}
+
+// Hash and match the pages picked from p, which is pinned, then merge
+// them under the locks, those whose PTE hasn't changed meanwhile.
+static void
+mergebatch(struct proc *p, struct ksmbatch *b)
+{
+  pte_t *pte;
+  uint pa;
+  int j;
+
+  for(j = 0; j < b->n; j++)
+    match(b, j);
+
+  acquire(&p->mmlock);
+  acquire(&ksm.lock);
+  ksm.scanned += b->n;
+  for(j = 0; j < b->n; j++){
+    pa = b->page[j].pa;
+    pte = findpte(p->pgdir, b->page[j].va);
+    if(pte && (*pte & PTE_P) && PTE_ADDR(*pte) == pa && get_ref_count(pa) == 2)
+      mergepage(b, j, pte);
+    if(decr_ref_count(pa) == 0)
+      kfree(P2V(pa));
+  }
+  release(&ksm.lock);
+  release(&p->mmlock);
+  b->n = 0;
+}
+
+static void
+scanproc(int i)
+{
+  struct ksmbatch b;
+  struct mmap_region *r;
+  struct proc *p;
+  uint va;
+  int k, full;
+
+  if((p = pinproc(i)) == 0)
+    return;
+  b.n = 0;
+  // a full batch is merged, then the walk goes on from region k, va
+  k = 0;
+  va = 0;
+  do {
+    full = 0;
+    acquire(&p->mmlock);
+    for(; k < p->num_mmaps; k++, va = 0){
+      r = &p->mmaps[k];
+      if(!(r->flags & MAP_PRIVATE))
+        continue;
+      if(va < r->start_addr)
+        va = r->start_addr;
+      if(walkrange(p->pgdir, va, r->start_addr + r->length, pickfn, &b)){
+        full = 1;
+        va = b.page[b.n-1].va + PGSIZE;
+        break;
+      }
+    }
+    release(&p->mmlock);
+    mergebatch(p, &b);
+  } while(full);
+  unpinproc(p);
+}
+
+void
+ksminit(void)
+{
+  initlock(&ksm.lock, "ksm");
+}
+
+void
+ksmd(void)
+{
+  uint t0;
+  int i, n;
+
+  for(;;){
+    acquire(&tickslock);
+    t0 = ticks;
+    while((n = vmknob(VM_KSM_INTERVAL)) == 0 || ticks - t0 < n)
+      sleep(&ticks, &tickslock);
+    release(&tickslock);
+
+    prune();
+    for(i = 0; i < NPROC; i++)
+      scanproc(i);
+  }
+}
+
+// Merging statistics, for meminfo.
+void
+ksmstat(struct meminfo *mi)
+{
+  struct ksmpage *k;
+
+  acquire(&ksm.lock);
+  mi->ksm_shared = mi->ksm_saved = 0;
+  for(k = ksm.stable; k < &ksm.stable[NKSMSTABLE]; k++){
+    if(k->pa == 0)
+      continue;
+    mi->ksm_shared++;
+    // one reference is the table's, one mapper would need the page anyway
+    if(get_ref_count(k->pa) > 2)
+      mi->ksm_saved += get_ref_count(k->pa) - 2;
+  }
+  mi->ksm_scanned = ksm.scanned;
+  mi->ksm_merges = ksm.merges;
+  release(&ksm.lock);
+}
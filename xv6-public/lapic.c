@@ -191,6 +191,24 @@ fill_rtcdate(struct rtcdate *r)
   r->year   = cmos_read(YEAR);
 }
 
+// Size of physical memory in bytes, as the BIOS recorded it in
+// CMOS: registers 0x34-0x35 count the 64KB blocks above 16MB,
+// and 0x30-0x31 the 1KB blocks above 1MB (for machines with
+// less than 16MB). Returns 0 if neither is set.
+uint
+cmosmemsize(void)
+{
+  uint above1m, above16m;
+
+  above1m = cmos_read(0x30) | (cmos_read(0x31) << 8);
+  above16m = cmos_read(0x34) | (cmos_read(0x35) << 8);
+  if(above16m)
+    return 16*1024*1024 + above16m*64*1024;
+  if(above1m)
+    return 1024*1024 + above1m*1024;
+  return 0;
+}
+
 // qemu seems to use 24-hour GWT and the values are BCD encoded
 void
 cmostime(struct rtcdate *r)
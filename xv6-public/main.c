@@ -19,6 +19,7 @@ main(void)
 {
   kinit1(end, P2V(4*1024*1024)); // phys page allocator
   kvmalloc();      // kernel page table
+  slabinit();      // small-object allocator
   mpinit();        // detect other processors
   lapicinit();     // interrupt controller
   seginit();       // segment descriptors
@@ -30,10 +31,21 @@ main(void)
   tvinit();        // trap vectors
   binit();         // buffer cache
   fileinit();      // file table
+  pipeinit();      // pipe allocator
+  shminit();       // shared-memory objects
+  zraminit();      // compressed swap
+  ksminit();       // same-page merging
+  uffdinit();      // user fault queues
+  zygoteinit();    // program templates
   ideinit();       // disk 
   startothers();   // start other processors
-  kinit2(P2V(4*1024*1024), P2V(PHYSTOP)); // must come after startothers()
+  kinit2(P2V(4*1024*1024), P2V(phystop)); // must come after startothers()
   userinit();      // first user process
+  kthreadcreate("flushd", flushd);  // writeback of shared file maps
+  kthreadcreate("kswapd", kswapd);  // reclaim of anonymous maps
+  kthreadcreate("ksmd", ksmd);      // merging of identical private pages
+  kthreadcreate("khugepaged", khugepaged);  // huge pages for full 4MB spans
+  kthreadcreate("kidled", kidled);  // working-set estimation
   mpmain();        // finish this processor's setup
 }
 
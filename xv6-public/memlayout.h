@@ -1,12 +1,14 @@
 // Memory layout
 
 #define EXTMEM  0x100000            // Start of extended memory
-#define PHYSTOP 0xE000000           // Top physical memory
+#define PHYSTOP 0xE000000           // Top physical memory if the BIOS doesn't say
 #define DEVSPACE 0xFE000000         // Other devices are at high addresses
+#define E820MAP 0x8000              // BIOS memory map, saved by bootasm.S
 
 // Key addresses for address space layout (see kmap in vm.c for layout)
 #define KERNBASE 0x80000000         // First kernel virtual address
 #define KERNLINK (KERNBASE+EXTMEM)  // Address where kernel is linked
+#define PHYSMAX (DEVSPACE-KERNBASE) // Most physical memory the kernel can map
 
 #define V2P(a) (((uint) (a)) - KERNBASE)
 #define P2V(a) ((void *)(((char *) (a)) + KERNBASE))
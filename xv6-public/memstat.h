@@ -0,0 +1,63 @@
+// memory accounting structures shared by the kernel and user programs
+
+#ifndef MEMSTAT_H
+#define MEMSTAT_H
+
+// for `meminfo`: system-wide page counts
+struct meminfo {
+    int total_pages;    // pages handed to the page allocator at boot
+    int free_pages;     // pages currently free (including per-CPU caches)
+    int pgtable_pages;  // page directories and page tables
+    int pipe_pages;     // slab pages holding pipes
+    int bcache_pages;   // pages taken by the disk block cache
+    int swap_pages;     // anonymous pages swapped out to zram
+    int zram_bytes;     // compressed bytes holding them
+    int ksm_shared;     // frames shared by same-page merging
+    int ksm_saved;      // pages freed by merging into them
+    int ksm_scanned;    // pages ksmd has hashed since boot
+    int ksm_merges;     // pages ksmd has merged since boot
+};
+
+// for `pmeminfo`: page counts of one process
+struct pmeminfo {
+    int pid;
+    int resident;       // user pages present in the page table
+    int shared;         // resident pages also mapped by another page table
+    int cow;            // resident pages marked copy-on-write
+    int wmap;           // resident pages inside wmap regions
+    int swapped;        // pages swapped out
+    int huge;           // 4MB huge pages, also counted as resident
+};
+
+// for `faultstat`: page faults by how they were served
+#define FAULT_ANON     0  // anonymous page zero-filled
+#define FAULT_FILE     1  // page read in from a file
+#define FAULT_SHM      2  // shared-memory object page mapped
+#define FAULT_COW      3  // copy-on-write page copied
+#define FAULT_COWREUSE 4  // copy-on-write page made writable in place
+#define FAULT_SWAPIN   5  // page swapped back in
+#define FAULT_SEGV     6  // bad access; process killed
+#define FAULT_FAIL     7  // out of memory or I/O error; process killed
+#define FAULT_UFFD     8  // page supplied by a user fault handler
+#define NFAULT         9
+
+struct faultstat {
+    uint count[NFAULT];
+    uint64 cycles[NFAULT]; // rdtsc cycles in the handler, disk waits included
+    uint around;           // pages mapped ahead by fault-around, not faulted
+};
+
+// for `vmtune`: knobs of the memory daemons
+#define VM_FLUSH_INTERVAL 0  // ticks between flushd scans
+#define VM_DIRTY_EXPIRE   1  // ticks a shared file region may stay dirty
+#define VM_DIRTY_RATIO    2  // percent of memory dirty that forces writeback
+#define VM_SWAP_INTERVAL  3  // ticks between kswapd checks
+#define VM_SWAP_LOW       4  // percent of memory free below which kswapd reclaims
+#define VM_SWAP_HIGH      5  // percent of memory free kswapd reclaims up to
+#define VM_KSM_INTERVAL   6  // ticks between ksmd passes, 0 for none
+#define VM_THP_INTERVAL   7  // ticks between khugepaged passes, 0 for none
+#define VM_FAULT_AROUND   8  // most pages an anonymous fault maps, 1 for no fault-around
+#define VM_IDLE_INTERVAL  9  // ticks between kidled scans, 0 for none
+#define NVMTUNE           10
+
+#endif
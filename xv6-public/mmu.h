@@ -86,6 +86,7 @@ struct segdesc {
 #define NPDENTRIES      1024    // # directory entries per page directory
 #define NPTENTRIES      1024    // # PTEs per page table
 #define PGSIZE          4096    // bytes mapped by a page
+#define HUGEPGSIZE      (PGSIZE*NPTENTRIES) // bytes mapped by a PTE_PS page
 
 #define PTXSHIFT        12      // offset of PTX in a linear address
 #define PDXSHIFT        22      // offset of PDX in a linear address
@@ -97,13 +98,20 @@ struct segdesc {
 #define PTE_P           0x001   // Present
 #define PTE_W           0x002   // Writeable
 #define PTE_U           0x004   // User
+#define PTE_A           0x020   // Accessed
+#define PTE_D           0x040   // Dirty
 #define PTE_PS          0x080   // Page Size
 // added the copy-on-write here
 #define PTE_COW         0x200   // Copy-on-Write
+// not present, swapped out: the swap slot is in the address bits
+#define PTE_SWAP        0x400
+// present, and PTE_A was set when kidled last cleared it
+#define PTE_YOUNG       0x800
 
 // Address in page table or page directory entry
 #define PTE_ADDR(pte)   ((uint)(pte) & ~0xFFF)
 #define PTE_FLAGS(pte)  ((uint)(pte) &  0xFFF)
+#define PTE_SWAPSLOT(pte) ((uint)(pte) >> PTXSHIFT)
 
 // adding my own constants to work with PTEs
 // bits 11-9 are available for the OS - so for us
@@ -6,7 +6,16 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
-
+#include "memstat.h"
+
+// Locks, in the order they are taken:
+//   ptable.lock    slot allocation, pids, parent links and reaping
+//   p->mmlock      p's page table and regions (see proc.h)
+//   sleep queue    a queue below; a lock passed to sleep comes first
+//   p->lock        p's scheduling state, held across swtch
+//   c->rqlock      a CPU's run queue
+// No two sleep-queue or run-queue locks are held at once, and a
+// p->lock is never held while taking anyone's mmlock.
 struct {
   struct spinlock lock;
   struct proc proc[NPROC];
@@ -14,18 +23,44 @@ struct {
 
 static struct proc *initproc;
 
+// forkret's one-time setup of the file system
+static struct spinlock fslock;
+static int fsstarted, fsready;
+
+// Sleeping processes, hashed by channel, so that wakeup only looks at
+// those that may be sleeping on its channel.
+#define SLEEPQBITS 6
+#define NSLEEPQ (1 << SLEEPQBITS)
+
+static struct sleepq {
+  struct spinlock lock;
+  struct proc *head;
+} sleepq[NSLEEPQ];
+
 int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
 
-static void wakeup1(void *chan);
+static void makerunnable(struct proc *p);
 
 pte_t *walkpgdir(pde_t *pgdir, const void *va, int alloc);
 
 void
 pinit(void)
 {
+  struct proc *p;
+  int i;
+
   initlock(&ptable.lock, "ptable");
+  initlock(&fslock, "fsinit");
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    initlock(&p->lock, "proc");
+    initlock(&p->mmlock, "mm");
+  }
+  for(i = 0; i < NCPU; i++)
+    initlock(&cpus[i].rqlock, "runq");
+  for(i = 0; i < NSLEEPQ; i++)
+    initlock(&sleepq[i].lock, "sleepq");
 }
 
 // Must be called with interrupts disabled
@@ -90,6 +125,10 @@ allocproc(void)
 found:
   p->state = EMBRYO;
   p->pid = nextpid++;
+  p->lastcpu = -1;
+  memset(&p->sched, 0, sizeof(p->sched));
+  memset(&p->faults, 0, sizeof(p->faults));
+  memset(&p->ws, 0, sizeof(p->ws));
 
   release(&ptable.lock);
 
@@ -148,10 +187,93 @@ userinit(void)
   // run this process. the acquire forces the above
   // writes to be visible, and the lock is also needed
   // because the assignment might not be atomic.
-  acquire(&ptable.lock);
+  acquire(&p->lock);
 
-  p->state = RUNNABLE;
+  makerunnable(p);
+
+  release(&p->lock);
+}
 
+// Start a kernel thread running fn, which must never return. It
+// has a page table with only the kernel mappings and no parent.
+void
+kthreadcreate(char *name, void (*fn)(void))
+{
+  struct proc *p;
+
+  if((p = allocproc()) == 0 || (p->pgdir = setupkvm()) == 0)
+    panic("kthreadcreate");
+  p->sz = 0;
+  p->parent = 0;
+
+  // forkret returns into fn instead of trapret.
+  *(uint*)((char*)p->context + sizeof *p->context) = (uint)fn;
+  safestrcpy(p->name, name, sizeof(p->name));
+
+  acquire(&p->lock);
+  makerunnable(p);
+  release(&p->lock);
+}
+
+// Keep the process in ptable slot i from running, for a memory daemon
+// that changes its page table. Returns it, or 0 if the slot holds no
+// process that is alive and off-CPU. Until unpinproc the scheduler
+// passes it over, so it can't exit or touch its memory, and
+// switchuvm flushes its stale TLB entries when it next runs: its
+// PTEs can be changed under its mmlock alone, without ptable.lock.
+struct proc*
+pinproc(int i)
+{
+  struct proc *p;
+
+  p = &ptable.proc[i];
+  acquire(&p->lock);
+  if((p->state != SLEEPING && p->state != RUNNABLE) || p->pgdir == 0){
+    release(&p->lock);
+    return 0;
+  }
+  p->pinned++;
+  release(&p->lock);
+  return p;
+}
+
+void
+unpinproc(struct proc *p)
+{
+  acquire(&p->lock);
+  if(--p->pinned == 0 && p->parked){
+    p->parked = 0;
+    makerunnable(p);
+  }
+  release(&p->lock);
+}
+
+// Lock the process with the given pid for a change to its page
+// table. Returns it with ptable.lock and its mmlock held, or 0 if it
+// isn't alive. It may be running, so this is only for changes that
+// need no TLB flush, such as filling in a page that was not present.
+struct proc*
+lockpid(int pid)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid != pid || p->pgdir == 0)
+      continue;
+    if(p->state == SLEEPING || p->state == RUNNABLE || p->state == RUNNING){
+      acquire(&p->mmlock);
+      return p;
+    }
+  }
+  release(&ptable.lock);
+  return 0;
+}
+
+void
+unlockmm(struct proc *p)
+{
+  release(&p->mmlock);
   release(&ptable.lock);
 }
 
@@ -163,31 +285,66 @@ growproc(int n)
   uint sz;
   struct proc *curproc = myproc();
 
+  acquire(&curproc->mmlock);
   sz = curproc->sz;
   if(n > 0){
-    if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0){
+      release(&curproc->mmlock);
       return -1;
+    }
   } else if(n < 0){
-    if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0){
+      release(&curproc->mmlock);
       return -1;
+    }
   }
   curproc->sz = sz;
+  release(&curproc->mmlock);
   switchuvm(curproc);
   return 0;
 }
 
+// Start a child of the current process that runs pgdir, sz bytes of
+// user memory, from eip with stack pointer esp. Like fork, it gets the
+// caller's open files and directory, but none of its memory or maps.
+// pgdir becomes the child's, or is freed on failure. Returns the
+// child's pid, or -1.
 int
-if_is_shared(struct proc *p, uint va) {
-  int i;
-  for (i = 0; i < p->num_mmaps; i++) {
-    struct mmap_region *region = &p->mmaps[i];
-    uint start = region->start_addr;
-    uint end = start + PGROUNDUP(region->length);
-    if (va >= start && va < end) {
-      return 1;
-    }
+spawn(pde_t *pgdir, uint sz, uint eip, uint esp, char *name)
+{
+  int i, pid;
+  struct proc *np;
+  struct proc *curproc = myproc();
+
+  if((np = allocproc()) == 0){
+    freevm(pgdir);
+    return -1;
   }
-  return 0;
+  np->pgdir = pgdir;
+  np->sz = sz;
+  np->parent = curproc;
+  np->num_mmaps = 0;
+
+  memset(np->tf, 0, sizeof(*np->tf));
+  np->tf->cs = (SEG_UCODE << 3) | DPL_USER;
+  np->tf->ds = (SEG_UDATA << 3) | DPL_USER;
+  np->tf->es = np->tf->ds;
+  np->tf->ss = np->tf->ds;
+  np->tf->eflags = FL_IF;
+  np->tf->esp = esp;
+  np->tf->eip = eip;
+
+  for(i = 0; i < NOFILE; i++)
+    if(curproc->ofile[i])
+      np->ofile[i] = filedup(curproc->ofile[i]);
+  np->cwd = idup(curproc->cwd);
+  safestrcpy(np->name, name, sizeof(np->name));
+  pid = np->pid;
+
+  acquire(&np->lock);
+  makerunnable(np);
+  release(&np->lock);
+  return pid;
 }
 
 // Create a new process copying p as the parent.
@@ -205,8 +362,14 @@ fork(void)
     return -1;
   }
 
+  // The parent's address space is copied and marked copy-on-write
+  // under its own mmlock, not ptable.lock, so a big fork does not
+  // hold up the scheduler on other CPUs.
+  acquire(&curproc->mmlock);
+
   // Copy process state from proc.
-  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz, curproc)) == 0){
+  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
+    release(&curproc->mmlock);
     kfree(np->kstack);
     np->kstack = 0;
     np->state = UNUSED;
@@ -220,52 +383,39 @@ fork(void)
   np->num_mmaps = curproc->num_mmaps;
   for (i = 0; i < curproc->num_mmaps; i++) {
     struct mmap_region *parent_region = &curproc->mmaps[i];
-    struct mmap_region *child_region = &np->mmaps[i];
-
-    // copying all of it
-    *child_region = *parent_region;
-
-    for (uint va = parent_region->start_addr; va < parent_region->start_addr + parent_region->length; va += PGSIZE) {
-      pte_t *pte = walkpgdir(curproc->pgdir, (void *)va, 0);
-      if (pte && (*pte & PTE_P)) {
-        uint pa = PTE_ADDR(*pte);
-        // adding the same page table from the parent to the child so that they share the same physical pages
-        mapthepages(np->pgdir, (void*)va, PGSIZE, pa, PTE_FLAGS(*pte));
-        incr_ref_count(pa / PGSIZE);
-      }
-    }
 
-    if (parent_region->f) {
-      filedup(parent_region->f);
+    // copying all of it, with the child's own copy of the page protections
+    np->mmaps[i] = *parent_region;
+
+    // the child's faults are its own to handle, not the uffd's
+    np->mmaps[i].uffd = 0;
+
+    // adding the same pages from the parent to the child so that they share the same physical pages.
+    // MAP_PRIVATE pages are shared copy-on-write, like the rest of the address space
+    if (protdup(&np->mmaps[i]) < 0 ||
+        sharerange(curproc->pgdir, np->pgdir, parent_region->start_addr,
+                   parent_region->start_addr + parent_region->length,
+                   parent_region->flags & MAP_PRIVATE) < 0) {
+      release(&curproc->mmlock);
+      for (int k = 0; k <= i; k++) {
+        protfree(&np->mmaps[k]);
+      }
+      freevm(np->pgdir);
+      np->pgdir = 0;
+      kfree(np->kstack);
+      np->kstack = 0;
+      np->state = UNUSED;
+      return -1;
     }
   }
-
-  acquire(&ptable.lock);
-  for(i = 0; i < curproc->sz; i += PGSIZE) {
-
-    if (if_is_shared(curproc, i)) {
-      continue;
-    }
-
-    pte_t *pte = walkpgdir(curproc->pgdir, (void *) i, 0);
-
-    if(!pte) {
-      continue;
-    }
-
-    if(!(*pte & PTE_P)) {
-      continue;
-    }
-    uint flags = PTE_FLAGS(*pte);
-
-    if(flags & PTE_W) {
-      *pte &= ~PTE_W;
-      *pte |= PTE_COW;
+  for (i = 0; i < np->num_mmaps; i++) {
+    if (np->mmaps[i].f) {
+      filedup(np->mmaps[i].f);
     }
   }
 
   lcr3(V2P(curproc->pgdir));
-  release(&ptable.lock);
+  release(&curproc->mmlock);
 
   // Clear %eax so that fork returns 0 in the child.
   np->tf->eax = 0;
@@ -279,11 +429,11 @@ fork(void)
 
   pid = np->pid;
 
-  acquire(&ptable.lock);
+  acquire(&np->lock);
 
-  np->state = RUNNABLE;
+  makerunnable(np);
 
-  release(&ptable.lock);
+  release(&np->lock);
 
   return pid;
 }
@@ -301,10 +451,10 @@ exit(void)
   if(curproc == initproc)
     panic("init exiting");
 
-  for (int i = 0; i < curproc->num_mmaps; i++) {
-    wunmap(curproc->mmaps[i].start_addr);
+  // wunmap removes the region from mmaps[], so always take the first
+  while (curproc->num_mmaps > 0) {
+    wunmap(curproc->mmaps[0].start_addr);
   }
-  curproc->num_mmaps = 0;
 
   // Close all open files.
   for(fd = 0; fd < NOFILE; fd++){
@@ -322,19 +472,24 @@ exit(void)
   acquire(&ptable.lock);
 
   // Parent might be sleeping in wait().
-  wakeup1(curproc->parent);
+  wakeup(curproc->parent);
 
   // Pass abandoned children to init.
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
     if(p->parent == curproc){
       p->parent = initproc;
       if(p->state == ZOMBIE)
-        wakeup1(initproc);
+        wakeup(initproc);
     }
   }
 
-  // Jump into the scheduler, never to return.
+  // Jump into the scheduler, never to return. The parent can see
+  // ZOMBIE once ptable.lock is released, but can't reap the slot
+  // before taking p->lock, which is held until this process is off
+  // its kernel stack.
+  acquire(&curproc->lock);
   curproc->state = ZOMBIE;
+  release(&ptable.lock);
   sched();
   panic("zombie exit");
 }
@@ -346,6 +501,8 @@ wait(void)
 {
   struct proc *p;
   int havekids, pid;
+  char *kstack;
+  pde_t *pgdir;
   struct proc *curproc = myproc();
   
   acquire(&ptable.lock);
@@ -357,17 +514,29 @@ wait(void)
         continue;
       havekids = 1;
       if(p->state == ZOMBIE){
-        // Found one.
+        // Found one. Only recycle the slot under ptable.lock; the
+        // kernel stack and address space are freed after releasing
+        // it, so a big teardown doesn't hold up every other CPU.
+        // Taking p->lock waits for the child to be switched out for
+        // good; after that only ptable.lock guards the slot.
+        acquire(&p->lock);
+        release(&p->lock);
         pid = p->pid;
-        kfree(p->kstack);
+        kstack = p->kstack;
         p->kstack = 0;
-        freevm(p->pgdir);
+        acquire(&p->mmlock);
+        pgdir = p->pgdir;
+        p->pgdir = 0;
+        p->sz = 0;
+        release(&p->mmlock);
         p->pid = 0;
         p->parent = 0;
         p->name[0] = 0;
         p->killed = 0;
         p->state = UNUSED;
         release(&ptable.lock);
+        kfree(kstack);
+        freevm(pgdir);
         return pid;
       }
     }
@@ -378,12 +547,85 @@ wait(void)
       return -1;
     }
 
-    // Wait for children to exit.  (See wakeup1 call in proc_exit.)
+    // Wait for children to exit.  (See wakeup call in proc_exit.)
     sleep(curproc, &ptable.lock);  //DOC: wait-sleep
   }
 }
 
 //PAGEBREAK: 42
+// Run queues.
+// Each CPU keeps its own FIFO of RUNNABLE processes, so picking the
+// next one doesn't mean scanning the whole table. A process goes back
+// on the queue of the CPU it last ran on, to find its cache warm
+// there; a CPU whose queue is empty steals from the longest one.
+//
+// Scheduling doesn't take ptable.lock, which only guards the table
+// itself: allocating and reaping slots, pids and parent links. Each
+// run queue has its own lock, and so has each sleep queue. A
+// process's state and chan are under its own p->lock, which is held
+// across the switch into and out of it, so that no other CPU picks it
+// up before it is off its kernel stack. The order is ptable.lock,
+// then a sleep queue, then p->lock, then a run queue; a lock passed to
+// sleep comes before all of them, and no two run queues or two sleep
+// queues are held at once.
+
+// Mark p RUNNABLE and queue it. Caller holds p->lock.
+static void
+makerunnable(struct proc *p)
+{
+  struct cpu *c;
+
+  p->state = RUNNABLE;
+  if(p->lastcpu < 0)
+    p->lastcpu = cpuid();
+  c = &cpus[p->lastcpu];
+  acquire(&c->rqlock);
+  p->rqnext = 0;
+  if(c->rqtail)
+    c->rqtail->rqnext = p;
+  else
+    c->rqhead = p;
+  c->rqtail = p;
+  c->nrq++;
+  release(&c->rqlock);
+}
+
+// Take the process at the head of c's queue, if any.
+static struct proc*
+rqpop(struct cpu *c)
+{
+  struct proc *p;
+
+  acquire(&c->rqlock);
+  if((p = c->rqhead) != 0){
+    c->rqhead = p->rqnext;
+    if(c->rqhead == 0)
+      c->rqtail = 0;
+    c->nrq--;
+    p->rqnext = 0;
+  }
+  release(&c->rqlock);
+  return p;
+}
+
+// Take the next process for c off its queue, or off the longest
+// other queue if c's is empty. The lengths are read without the
+// locks, as a hint; rqpop copes with a queue that emptied meanwhile.
+static struct proc*
+dequeue(struct cpu *c)
+{
+  struct cpu *v, *busiest;
+  struct proc *p;
+
+  if((p = rqpop(c)) != 0)
+    return p;
+  busiest = 0;
+  for(v = cpus; v < &cpus[ncpu]; v++)
+    if(v != c && v->nrq > 0 && (busiest == 0 || v->nrq > busiest->nrq))
+      busiest = v;
+  return busiest ? rqpop(busiest) : 0;
+}
+
 // Per-CPU process scheduler.
 // Each CPU calls scheduler() after setting itself up.
 // Scheduler never returns.  It loops, doing:
@@ -402,32 +644,44 @@ scheduler(void)
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
-    acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->state != RUNNABLE)
-        continue;
-
-      // Switch to chosen process.  It is the process's job
-      // to release ptable.lock and then reacquire it
-      // before jumping back to us.
-      c->proc = p;
-      switchuvm(p);
-      p->state = RUNNING;
-
-      swtch(&(c->scheduler), p->context);
-      switchkvm();
+    if((p = dequeue(c)) == 0){
+      // Nothing to run: use the time to pre-zero free pages.
+      kzeroidle();
+      continue;
+    }
 
-      // Process is done running for now.
-      // It should have changed its p->state before coming back.
-      c->proc = 0;
+    // Off the queues, p is this CPU's; p->lock may still be held by
+    // the CPU it is leaving.
+    acquire(&p->lock);
+    if(p->pinned){
+      // left off the queues until unpinproc
+      p->parked = 1;
+      release(&p->lock);
+      continue;
     }
-    release(&ptable.lock);
 
+    // Switch to chosen process.  It is the process's job
+    // to release p->lock and then reacquire it
+    // before jumping back to us.
+    c->proc = p;
+    p->sched.runs++;
+    if(p->lastcpu != c - cpus)
+      p->sched.steals++;
+    p->lastcpu = c - cpus;
+    switchuvm(p);
+    p->state = RUNNING;
+
+    swtch(&(c->scheduler), p->context);
+    switchkvm();
+
+    // Process is done running for now.
+    // It should have changed its p->state before coming back.
+    c->proc = 0;
+    release(&p->lock);
   }
 }
 
-// Enter scheduler.  Must hold only ptable.lock
+// Enter scheduler.  Must hold only p->lock
 // and have changed proc->state. Saves and restores
 // intena because intena is a property of this
 // kernel thread, not this CPU. It should
@@ -440,8 +694,8 @@ sched(void)
   int intena;
   struct proc *p = myproc();
 
-  if(!holding(&ptable.lock))
-    panic("sched ptable.lock");
+  if(!holding(&p->lock))
+    panic("sched p->lock");
   if(mycpu()->ncli != 1)
     panic("sched locks");
   if(p->state == RUNNING)
@@ -457,10 +711,12 @@ sched(void)
 void
 yield(void)
 {
-  acquire(&ptable.lock);  //DOC: yieldlock
-  myproc()->state = RUNNABLE;
+  struct proc *p = myproc();
+
+  acquire(&p->lock);  //DOC: yieldlock
+  makerunnable(p);
   sched();
-  release(&ptable.lock);
+  release(&p->lock);
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -468,20 +724,38 @@ yield(void)
 void
 forkret(void)
 {
-  static int first = 1;
-  // Still holding ptable.lock from scheduler.
-  release(&ptable.lock);
-
-  if (first) {
-    // Some initialization functions must be run in the context
-    // of a regular process (e.g., they call sleep), and thus cannot
-    // be run from main().
-    first = 0;
-    iinit(ROOTDEV);
-    initlog(ROOTDEV);
+  // Still holding p->lock from scheduler.
+  release(&myproc()->lock);
+
+  if(!fsready){
+    acquire(&fslock);
+    if(!fsstarted){
+      // Some initialization functions must be run in the context
+      // of a regular process (e.g., they call sleep), and thus cannot
+      // be run from main().
+      fsstarted = 1;
+      release(&fslock);
+      iinit(ROOTDEV);
+      initlog(ROOTDEV);
+      acquire(&fslock);
+      fsready = 1;
+      wakeup(&fsready);
+    }
+    // A kernel thread may get here on another CPU while the file
+    // system is still being set up.
+    while(!fsready)
+      sleep(&fsready, &fslock);
+    release(&fslock);
   }
 
-  // Return to "caller", actually trapret (see allocproc).
+  // Return to "caller", actually trapret (see allocproc), or the
+  // body of a kernel thread (see kthreadcreate).
+}
+
+static struct sleepq*
+sleepqof(void *chan)
+{
+  return &sleepq[((uint)chan * 2654435761U) >> (32 - SLEEPQBITS)];
 }
 
 // Atomically release lock and sleep on chan.
@@ -490,6 +764,7 @@ void
 sleep(void *chan, struct spinlock *lk)
 {
   struct proc *p = myproc();
+  struct sleepq *q;
   
   if(p == 0)
     panic("sleep");
@@ -497,52 +772,76 @@ sleep(void *chan, struct spinlock *lk)
   if(lk == 0)
     panic("sleep without lk");
 
-  // Must acquire ptable.lock in order to
-  // change p->state and then call sched.
-  // Once we hold ptable.lock, we can be
-  // guaranteed that we won't miss any wakeup
-  // (wakeup runs with ptable.lock locked),
-  // so it's okay to release lk.
-  if(lk != &ptable.lock){  //DOC: sleeplock0
-    acquire(&ptable.lock);  //DOC: sleeplock1
-    release(lk);
-  }
-  // Go to sleep.
+  // Once p is SLEEPING on chan's queue, it's okay to release lk:
+  // a wakeup that follows finds p there, and waits for p->lock,
+  // which is held until p has been switched out.
+  q = sleepqof(chan);
+  acquire(&q->lock);
+  acquire(&p->lock);
   p->chan = chan;
   p->state = SLEEPING;
+  p->sqnext = q->head;
+  q->head = p;
+  release(&q->lock);
+  release(lk);
 
+  // Go to sleep.
   sched();
 
   // Tidy up.
   p->chan = 0;
+  release(&p->lock);
 
   // Reacquire original lock.
-  if(lk != &ptable.lock){  //DOC: sleeplock2
-    release(&ptable.lock);
-    acquire(lk);
-  }
+  acquire(lk);
 }
 
 //PAGEBREAK!
-// Wake up all processes sleeping on chan.
-// The ptable lock must be held.
-static void
-wakeup1(void *chan)
+// Wake up all processes sleeping on chan. Only chan's sleep queue
+// is looked at, not the whole table.
+void
+wakeup(void *chan)
 {
-  struct proc *p;
-
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
-      p->state = RUNNABLE;
+  struct sleepq *q;
+  struct proc *p, **pp;
+
+  q = sleepqof(chan);
+  acquire(&q->lock);
+  // a process is on the queue exactly while it sleeps on p->chan
+  for(pp = &q->head; (p = *pp) != 0; ){
+    if(p->chan != chan){
+      pp = &p->sqnext;
+      continue;
+    }
+    *pp = p->sqnext;
+    acquire(&p->lock);
+    makerunnable(p);
+    release(&p->lock);
+  }
+  release(&q->lock);
 }
 
-// Wake up all processes sleeping on chan.
-void
-wakeup(void *chan)
+// Wake p if it still sleeps on chan. Returns 0 if it doesn't.
+static int
+unsleep(struct proc *p, void *chan)
 {
-  acquire(&ptable.lock);
-  wakeup1(chan);
-  release(&ptable.lock);
+  struct sleepq *q;
+  struct proc **pp;
+
+  q = sleepqof(chan);
+  acquire(&q->lock);
+  for(pp = &q->head; *pp != 0; pp = &(*pp)->sqnext){
+    if(*pp == p && p->chan == chan){
+      *pp = p->sqnext;
+      acquire(&p->lock);
+      makerunnable(p);
+      release(&p->lock);
+      release(&q->lock);
+      return 1;
+    }
+  }
+  release(&q->lock);
+  return 0;
 }
 
 // Kill the process with the given pid.
@@ -552,14 +851,22 @@ int
 kill(int pid)
 {
   struct proc *p;
+  void *chan;
 
   acquire(&ptable.lock);
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
     if(p->pid == pid){
+      acquire(&p->lock);
       p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
+      release(&p->lock);
+      // Wake process from sleep if necessary. Its sleep queue has
+      // to be locked before p, so chan is read first and the wakeup
+      // retried if p went to sleep elsewhere meanwhile.
+      do {
+        acquire(&p->lock);
+        chan = p->state == SLEEPING ? p->chan : 0;
+        release(&p->lock);
+      } while(chan && !unsleep(p, chan));
       release(&ptable.lock);
       return 0;
     }
@@ -604,3 +911,85 @@ procdump(void)
     cprintf("\n");
   }
 }
+
+// Fill in *pm with the memory use of the process with the given pid.
+// Returns -1 if there is no such process.
+int
+procmeminfo(int pid, struct pmeminfo *pm)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED && p->state != EMBRYO && p->pgdir){
+      acquire(&p->mmlock);
+      uvmstat(p, pm);
+      release(&p->mmlock);
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Copy the page-fault counts of process pid into fs.
+int
+procfaultstat(int pid, struct faultstat *fs)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED && p->state != EMBRYO){
+      acquire(&p->mmlock);
+      *fs = p->faults;
+      release(&p->mmlock);
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Copy kidled's latest working-set counts of process pid into ws.
+int
+procwsinfo(int pid, struct wsinfo *ws)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED && p->state != EMBRYO){
+      acquire(&p->mmlock);
+      *ws = p->ws;
+      release(&p->mmlock);
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Copy the scheduling counts of process pid into si.
+int
+procschedinfo(int pid, struct schedinfo *si)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED && p->state != EMBRYO){
+      acquire(&p->lock);
+      *si = p->sched;
+      si->lastcpu = p->lastcpu;
+      release(&p->lock);
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
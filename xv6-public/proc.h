@@ -3,6 +3,12 @@
 
 // so that proc.h has access to MAX_WMMAP_INFO constant value
 #include "wmap.h"
+// and to struct spinlock for the per-process mmlock
+#include "spinlock.h"
+// and to struct faultstat
+#include "memstat.h"
+// and to struct schedinfo
+#include "schedstat.h"
 
 // Per-CPU state
 struct cpu {
@@ -14,6 +20,10 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  struct spinlock rqlock;      // Protects the run queue below
+  struct proc *rqhead;         // RUNNABLE processes waiting for this cpu,
+  struct proc *rqtail;         //   oldest first
+  int nrq;                     // Number of them
 };
 
 extern struct cpu cpus[NCPU];
@@ -47,7 +57,13 @@ struct mmap_region {
   int flags;             // Flags (e.g., MAP_SHARED, MAP_ANONYMOUS, etc.)
   int fd;                // File descriptor if file-backed, -1 if anonymous
   struct file *f;        // Pointer to the file struct if file-backed
+  uint offset;           // File offset mapped at start_addr (page-aligned)
   int loaded_pages;      // Number of pages physically allocated (lazy allocation)
+  uint dirtysince;       // Tick at which flushd first saw it dirty, or 0
+  uint nextfault;        // Where a sequential anonymous fault lands next
+  int window;            // Pages fault-around maps after the next such fault
+  uchar *rdonly;         // Bitmap of the pages wprotect made read-only, or 0
+  struct uffd *uffd;     // Fault queue for pages not there yet, or 0
 };
 
 // Per-process state
@@ -60,6 +76,14 @@ struct proc {
   struct proc *parent;         // Parent process
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
+  struct spinlock lock;        // Protects state, chan, lastcpu, pinned,
+                               //   parked, sched; held across swtch
+  struct proc *rqnext;         // Next on its run queue, under the queue's lock
+  struct proc *sqnext;         // Next on its sleep queue, likewise
+  int lastcpu;                 // CPU it last ran on, or -1
+  int pinned;                  // Memory daemons keeping it off the CPUs
+  int parked;                  // RUNNABLE, but off the queues while pinned
+  struct schedinfo sched;      // How it has been scheduled
   void *chan;                  // If non-zero, sleeping on chan
   int killed;                  // If non-zero, have been killed
   struct file *ofile[NOFILE];  // Open files
@@ -69,6 +93,14 @@ struct proc {
   // memory mapped regions
   struct mmap_region mmaps[MAX_WMMAP_INFO];    // Array to store memory-mapped regions
   int num_mmaps;                               // Number of active memory-mapped regions
+
+  // protects pgdir's user half, sz and mmaps[]. Never held across a
+  // sleep. Taken after ptable.lock and before the sleep-queue, p->lock
+  // and run-queue locks (see the list at the top of proc.c).
+  struct spinlock mmlock;
+
+  struct faultstat faults;     // page faults taken, under mmlock
+  struct wsinfo ws;            // kidled's latest counts, under mmlock
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -0,0 +1,13 @@
+// scheduling statistics shared by the kernel and user programs
+
+#ifndef SCHEDSTAT_H
+#define SCHEDSTAT_H
+
+// for `getschedinfo`: how a process has been scheduled
+struct schedinfo {
+    int runs;           // times a CPU switched to it
+    int steals;         // of those, times it was taken from another CPU's queue
+    int lastcpu;        // CPU it last ran on, or -1
+};
+
+#endif
@@ -0,0 +1,183 @@
+// Named shared-memory objects.
+//
+// shm_open(name, size) returns a file descriptor for a named object
+// of anonymous memory; wmap on that descriptor maps the object's
+// pages, so unrelated processes that open the same name share them.
+// An object lives until it has been unlinked and the last file
+// referring to it is closed. Its pages are allocated on first touch
+// and hold one reference for the object, plus one per mapping.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "fs.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "file.h"
+
+#define NSHM        16
+#define SHMNAME     16
+#define SHMMAXPAGES (PGSIZE / sizeof(uint))
+
+struct shm {
+  char name[SHMNAME];   // empty once unlinked
+  int size;             // bytes
+  int ref;              // open files referring to the object
+  uint *pages;          // physical address of each page, or 0
+};
+
+struct {
+  struct spinlock lock;
+  struct shm shm[NSHM];
+} shmtable;
+
+void
+shminit(void)
+{
+  initlock(&shmtable.lock, "shm");
+}
+
+// Free s's pages once nothing refers to it. Caller holds shmtable.lock.
+static void
+shmfree(struct shm *s)
+{
+  uint i;
+
+  for(i = 0; i < SHMMAXPAGES; i++){
+    if(s->pages[i] && decr_ref_count(s->pages[i]) == 0)
+      kfree(P2V(s->pages[i]));
+  }
+  kfree((char*)s->pages);
+  s->pages = 0;
+  s->size = 0;
+}
+
+static struct shm*
+shmlookup(char *name)
+{
+  struct shm *s;
+
+  for(s = shmtable.shm; s < &shmtable.shm[NSHM]; s++)
+    if(s->pages && s->name[0] && strncmp(s->name, name, SHMNAME) == 0)
+      return s;
+  return 0;
+}
+
+// Open the object called name, creating it with size bytes if it
+// does not exist yet, and return a file referring to it in *f.
+int
+shmopen(char *name, int size, struct file **f)
+{
+  struct shm *s;
+  char *pages;
+
+  if(name[0] == 0 || size < 0 || size > SHMMAXPAGES * PGSIZE)
+    return -1;
+  if((*f = filealloc()) == 0)
+    return -1;
+  // the page array is allocated before taking the lock, and given
+  // back if the object turns out to exist already
+  if((pages = kalloc_zeroed()) == 0){
+    fileclose(*f);
+    return -1;
+  }
+
+  acquire(&shmtable.lock);
+  if((s = shmlookup(name)) != 0){
+    if(size > s->size)
+      goto bad;
+    kfree(pages);
+  } else {
+    if(size == 0)
+      goto bad;
+    for(s = shmtable.shm; s < &shmtable.shm[NSHM]; s++)
+      if(s->pages == 0)
+        break;
+    if(s == &shmtable.shm[NSHM])
+      goto bad;
+    safestrcpy(s->name, name, SHMNAME);
+    s->size = size;
+    s->ref = 0;
+    s->pages = (uint*)pages;
+  }
+  s->ref++;
+  release(&shmtable.lock);
+
+  (*f)->type = FD_SHM;
+  (*f)->readable = 1;
+  (*f)->writable = 1;
+  (*f)->shm = s;
+  return 0;
+
+ bad:
+  release(&shmtable.lock);
+  kfree(pages);
+  fileclose(*f);
+  return -1;
+}
+
+// Remove name. The object's memory is freed when the last file
+// referring to it is closed.
+int
+shmunlink(char *name)
+{
+  struct shm *s;
+
+  acquire(&shmtable.lock);
+  if((s = shmlookup(name)) == 0){
+    release(&shmtable.lock);
+    return -1;
+  }
+  s->name[0] = 0;
+  if(s->ref == 0)
+    shmfree(s);
+  release(&shmtable.lock);
+  return 0;
+}
+
+// Called by fileclose when the last reference to an FD_SHM file goes.
+void
+shmclose(struct shm *s)
+{
+  acquire(&shmtable.lock);
+  if(--s->ref == 0 && s->name[0] == 0)
+    shmfree(s);
+  release(&shmtable.lock);
+}
+
+int
+shmsize(struct shm *s)
+{
+  return s->size;
+}
+
+// Return the physical address of page i of s, allocating it if this
+// is the first touch, with a reference added for the caller's
+// mapping. Returns 0 if i is past the end or memory ran out.
+uint
+shmpage(struct shm *s, uint i)
+{
+  char *mem;
+  uint pa;
+
+  acquire(&shmtable.lock);
+  if(i >= PGROUNDUP(s->size) / PGSIZE){
+    release(&shmtable.lock);
+    return 0;
+  }
+  if(s->pages[i] == 0){
+    if((mem = kalloc_zeroed()) == 0){
+      release(&shmtable.lock);
+      return 0;
+    }
+    s->pages[i] = V2P(mem);
+    incr_ref_count(s->pages[i]);
+  }
+  pa = s->pages[i];
+  incr_ref_count(pa);
+  release(&shmtable.lock);
+  return pa;
+}
@@ -0,0 +1,206 @@
+// Slab allocator for kernel objects smaller than a page.
+//
+// A kmem_cache hands out objects of one size, carved from
+// pages obtained with kalloc(). Each page (a slab) starts with
+// a struct slab and holds as many objects as fit after it.
+// Each CPU keeps up to SLABMAG free objects per cache, so
+// most allocations and frees take no lock at all; the cache
+// lock is only taken to move objects between a CPU and the slabs.
+//
+// kmalloc()/kmfree() sit on top with power-of-two size classes.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "slab.h"
+
+#define SLABHDR   ((sizeof(struct slab) + 7) & ~7)
+#define KMALLOCMIN 16
+#define KMALLOCMAX 1024
+
+static struct kmem_cache kmalloc_caches[7];   // 16 .. 1024 bytes
+static char *kmalloc_names[] = {
+  "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+  "kmalloc-256", "kmalloc-512", "kmalloc-1024",
+};
+
+void
+kmem_cache_init(struct kmem_cache *c, char *name, uint size)
+{
+  int i;
+
+  if(size == 0 || size > PGSIZE - SLABHDR)
+    panic("kmem_cache_init: size");
+  initlock(&c->lock, name);
+  c->name = name;
+  c->size = (size + 7) & ~7;
+  c->perslab = (PGSIZE - SLABHDR) / c->size;
+  c->partial = 0;
+  c->nslabs = 0;
+  for(i = 0; i < NCPU; i++)
+    c->cpu[i].n = 0;
+}
+
+void
+slabinit(void)
+{
+  int i;
+  uint size;
+
+  for(i = 0, size = KMALLOCMIN; size <= KMALLOCMAX; i++, size <<= 1)
+    kmem_cache_init(&kmalloc_caches[i], kmalloc_names[i], size);
+}
+
+static void
+partialadd(struct kmem_cache *c, struct slab *s)
+{
+  s->prev = 0;
+  s->next = c->partial;
+  if(s->next)
+    s->next->prev = s;
+  c->partial = s;
+}
+
+static void
+partialremove(struct kmem_cache *c, struct slab *s)
+{
+  if(s->prev)
+    s->prev->next = s->next;
+  else
+    c->partial = s->next;
+  if(s->next)
+    s->next->prev = s->prev;
+}
+
+// Get a fresh page and thread all its objects onto a free list.
+// Caller holds c->lock.
+static struct slab*
+slabgrow(struct kmem_cache *c)
+{
+  struct slab *s;
+  char *obj;
+  int i;
+
+  if((s = (struct slab*)kalloc()) == 0)
+    return 0;
+  s->cache = c;
+  s->inuse = 0;
+  s->freelist = 0;
+  obj = (char*)s + SLABHDR + (c->perslab - 1) * c->size;
+  for(i = 0; i < c->perslab; i++, obj -= c->size){
+    *(void**)obj = s->freelist;
+    s->freelist = obj;
+  }
+  c->nslabs++;
+  partialadd(c, s);
+  return s;
+}
+
+// Take one object from the slabs. Caller holds c->lock.
+static void*
+slaballoc(struct kmem_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  if((s = c->partial) == 0 && (s = slabgrow(c)) == 0)
+    return 0;
+  obj = s->freelist;
+  s->freelist = *(void**)obj;
+  if(++s->inuse == c->perslab)
+    partialremove(c, s);
+  return obj;
+}
+
+// Return one object to its slab, giving the page back
+// when the slab becomes empty. Caller holds c->lock.
+static void
+slabfree(struct kmem_cache *c, void *obj)
+{
+  struct slab *s;
+
+  s = (struct slab*)PGROUNDDOWN((uint)obj);
+  if(s->cache != c)
+    panic("slabfree: wrong cache");
+  if(s->inuse-- == c->perslab)
+    partialadd(c, s);
+  *(void**)obj = s->freelist;
+  s->freelist = obj;
+  if(s->inuse == 0){
+    partialremove(c, s);
+    c->nslabs--;
+    kfree((char*)s);
+  }
+}
+
+// Allocate one object from cache c.
+// Returns 0 if memory cannot be allocated.
+void*
+kmem_cache_alloc(struct kmem_cache *c)
+{
+  struct kmem_cpu *m;
+  void *obj, *o;
+
+  pushcli();
+  m = &c->cpu[cpuid()];
+  if(m->n > 0){
+    obj = m->obj[--m->n];
+    popcli();
+    return obj;
+  }
+
+  // Empty: take one for the caller and refill half the array.
+  acquire(&c->lock);
+  obj = slaballoc(c);
+  while(obj && m->n < SLABMAG/2 && (o = slaballoc(c)) != 0)
+    m->obj[m->n++] = o;
+  release(&c->lock);
+  popcli();
+  return obj;
+}
+
+// Free an object allocated from cache c.
+void
+kmem_cache_free(struct kmem_cache *c, void *obj)
+{
+  struct kmem_cpu *m;
+
+  pushcli();
+  m = &c->cpu[cpuid()];
+  if(m->n == SLABMAG){
+    // Full: give half back to the slabs.
+    acquire(&c->lock);
+    while(m->n > SLABMAG/2)
+      slabfree(c, m->obj[--m->n]);
+    release(&c->lock);
+  }
+  m->obj[m->n++] = obj;
+  popcli();
+}
+
+// Allocate n bytes, n <= KMALLOCMAX.
+// Returns 0 if memory cannot be allocated.
+void*
+kmalloc(uint n)
+{
+  struct kmem_cache *c;
+
+  if(n > KMALLOCMAX)
+    return 0;
+  for(c = kmalloc_caches; c->size < n; c++)
+    ;
+  return kmem_cache_alloc(c);
+}
+
+// Free memory returned by kmalloc().
+void
+kmfree(void *p)
+{
+  struct slab *s;
+
+  s = (struct slab*)PGROUNDDOWN((uint)p);
+  kmem_cache_free(s->cache, p);
+}
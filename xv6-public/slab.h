@@ -0,0 +1,34 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "spinlock.h"
+
+#define SLABMAG 8   // free objects each CPU keeps per cache
+
+// A slab is one page from kalloc(): this header, then objects.
+struct slab {
+  struct slab *next;           // on the cache's partial list
+  struct slab *prev;
+  struct kmem_cache *cache;
+  void *freelist;              // free objects in this slab
+  int inuse;                   // objects handed out
+};
+
+// Free objects kept by one CPU for one cache.
+struct kmem_cpu {
+  int n;
+  void *obj[SLABMAG];
+};
+
+// A cache of equal-sized objects smaller than a page.
+struct kmem_cache {
+  struct spinlock lock;        // protects partial and the slabs on it
+  char *name;
+  uint size;                   // object size, rounded up to 8 bytes
+  int perslab;                 // objects per slab
+  struct slab *partial;        // slabs with at least one free object
+  int nslabs;                  // pages currently held by this cache
+  struct kmem_cpu cpu[NCPU];   // per-CPU free objects; pushcli to use
+};
+
+#endif // SLAB_H
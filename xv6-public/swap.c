@@ -0,0 +1,191 @@
+// Reclaim of anonymous wmap memory.
+//
+// kswapd wakes every VM_SWAP_INTERVAL ticks. When fewer than
+// VM_SWAP_LOW percent of pages are free it swaps out cold pages of
+// anonymous wmap regions until VM_SWAP_HIGH percent are free. Cold
+// means PTE_A stayed clear since the previous scan, which clears it
+// (a second-chance clock). kidled moves PTE_A into PTE_YOUNG, which
+// counts the same. A swapped-out PTE is not present and
+// holds PTE_SWAP, the page's slot in the swap tier and its old
+// permission bits; the fault handler swaps it back in.
+//
+// The only swap tier is zram.c. A disk tier would slot in behind
+// swapbatch/swapin/swapfree without changing their callers.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "memstat.h"
+
+#define SWAPBATCH 16    // pages picked per process and pass
+
+// Replace the present page at pte with the swap entry for slot. The
+// caller still holds a reference to the page.
+static void
+swapout(pte_t *pte, int slot)
+{
+  uint pa;
+
+  pa = PTE_ADDR(*pte);
+  *pte = (slot << PTXSHIFT) | PTE_SWAP | (*pte & (PTE_W|PTE_U|PTE_COW));
+  decr_ref_count(pa);
+}
+
+// Bring the page behind the swap entry at pte back into memory.
+// Caller holds the owner's mmlock.
+int
+swapin(pte_t *pte)
+{
+  char *mem;
+  int slot;
+
+  if((mem = kalloc()) == 0)
+    return -1;
+  slot = PTE_SWAPSLOT(*pte);
+  zramload(slot, mem);
+  zramfree(slot);
+  *pte = V2P(mem) | PTE_P | (*pte & (PTE_W|PTE_U|PTE_COW));
+  incr_ref_count(V2P(mem));
+  return 0;
+}
+
+// Drop the swap entry at pte, for unmap and teardown.
+void
+swapfree(pte_t *pte)
+{
+  zramfree(PTE_SWAPSLOT(*pte));
+  *pte = 0;
+}
+
+struct reclaim {
+  int want;     // pages still to free
+  int n;        // pages picked from the current process
+  struct {
+    uint va;
+    uint pa;
+    int slot;
+  } page[SWAPBATCH];
+};
+
+// Pick the cold private pages, taking a reference to each so that it
+// stays put until it is compressed.
+static int
+scanfn(pte_t *pte, uint va, int n, void *arg)
+{
+  struct reclaim *r = arg;
+  uint pa;
+
+  for(; n > 0; n--, pte++, va += PGSIZE){
+    if(!(*pte & PTE_P))
+      continue;
+    if(*pte & (PTE_A|PTE_YOUNG)){
+      *pte &= ~(PTE_A|PTE_YOUNG);
+      continue;
+    }
+    // shared with another page table: swapping it out here frees
+    // nothing
+    pa = PTE_ADDR(*pte);
+    if(get_ref_count(pa) != 1)
+      continue;
+    incr_ref_count(pa);
+    r->page[r->n].va = va;
+    r->page[r->n].pa = pa;
+    r->n++;
+    if(r->n == r->want || r->n == SWAPBATCH)
+      return 1;
+  }
+  return 0;
+}
+
+// Swap out what scanfn picked from p, which is pinned. The pages are
+// compressed with p's mmlock released: p can't run, and a page only
+// it maps has no other writer. The swap entries are then installed
+// under mmlock where the PTE still maps the page and nobody else took
+// a reference meanwhile (ksmd or khugepaged may have).
+static void
+swapbatch(struct proc *p, struct reclaim *r)
+{
+  pte_t *pte;
+  uint pa;
+  int j, slot;
+
+  for(j = 0; j < r->n; j++)
+    r->page[j].slot = zramstore(P2V(r->page[j].pa));
+
+  acquire(&p->mmlock);
+  for(j = 0; j < r->n; j++){
+    pa = r->page[j].pa;
+    slot = r->page[j].slot;
+    pte = findpte(p->pgdir, r->page[j].va);
+    if(slot >= 0 && pte && (*pte & PTE_P) && PTE_ADDR(*pte) == pa &&
+       get_ref_count(pa) == 2){
+      swapout(pte, slot);
+      r->want--;
+    } else if(slot >= 0){
+      zramfree(slot);
+    }
+    if(decr_ref_count(pa) == 0)
+      kfree(P2V(pa));
+  }
+  release(&p->mmlock);
+  r->n = 0;
+}
+
+// Try to free want pages by swapping out cold anonymous pages.
+// Returns the number freed.
+static int
+reclaim(int want)
+{
+  struct reclaim r;
+  struct proc *p;
+  int i, k, round, before;
+
+  r.want = want;
+  r.n = 0;
+  for(round = 0; r.want > 0; round++){
+    before = r.want;
+    for(i = 0; i < NPROC && r.want > 0; i++){
+      if((p = pinproc(i)) == 0)
+        continue;
+      acquire(&p->mmlock);
+      for(k = 0; k < p->num_mmaps; k++){
+        if(!(p->mmaps[k].flags & MAP_ANONYMOUS))
+          continue;
+        if(walkrange(p->pgdir, p->mmaps[k].start_addr,
+                     p->mmaps[k].start_addr + p->mmaps[k].length,
+                     scanfn, &r))
+          break;
+      }
+      release(&p->mmlock);
+      swapbatch(p, &r);
+      unpinproc(p);
+    }
+    // the first round may only have cleared PTE_A
+    if(round > 0 && r.want == before)
+      break;
+  }
+  return want - r.want;
+}
+
+void
+kswapd(void)
+{
+  uint t0;
+  int total, nfree;
+
+  for(;;){
+    acquire(&tickslock);
+    t0 = ticks;
+    while(ticks - t0 < vmknob(VM_SWAP_INTERVAL))
+      sleep(&ticks, &tickslock);
+    release(&tickslock);
+
+    total = ktotalpages();
+    nfree = kfreepages();
+    if(nfree * 100 < vmknob(VM_SWAP_LOW) * total)
+      reclaim(vmknob(VM_SWAP_HIGH) * total / 100 - nfree);
+  }
+}
@@ -108,6 +108,23 @@ extern int sys_wmap(void);
 extern int sys_wunmap(void);
 extern int sys_va2pa(void);
 extern int sys_getwmapinfo(void);
+extern int sys_meminfo(void);
+extern int sys_pmeminfo(void);
+extern int sys_wmapoff(void);
+extern int sys_shm_open(void);
+extern int sys_shm_unlink(void);
+extern int sys_vmtune(void);
+extern int sys_faultstat(void);
+extern int sys_wprotect(void);
+extern int sys_uffd(void);
+extern int sys_wcopy(void);
+extern int sys_wzero(void);
+extern int sys_getwsinfo(void);
+extern int sys_checkpoint(void);
+extern int sys_restore(void);
+extern int sys_zygote(void);
+extern int sys_spawn_from(void);
+extern int sys_getschedinfo(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -136,6 +153,23 @@ static int (*syscalls[])(void) = {
 [SYS_wunmap]  sys_wunmap,
 [SYS_va2pa]   sys_va2pa,
 [SYS_getwmapinfo] sys_getwmapinfo,
+[SYS_meminfo] sys_meminfo,
+[SYS_pmeminfo] sys_pmeminfo,
+[SYS_wmapoff] sys_wmapoff,
+[SYS_shm_open] sys_shm_open,
+[SYS_shm_unlink] sys_shm_unlink,
+[SYS_vmtune] sys_vmtune,
+[SYS_faultstat] sys_faultstat,
+[SYS_wprotect] sys_wprotect,
+[SYS_uffd]    sys_uffd,
+[SYS_wcopy]   sys_wcopy,
+[SYS_wzero]   sys_wzero,
+[SYS_getwsinfo] sys_getwsinfo,
+[SYS_checkpoint] sys_checkpoint,
+[SYS_restore] sys_restore,
+[SYS_zygote]  sys_zygote,
+[SYS_spawn_from] sys_spawn_from,
+[SYS_getschedinfo] sys_getschedinfo,
 };
 
 void
@@ -25,4 +25,21 @@
 #define SYS_wunmap 23
 #define SYS_va2pa  24
 #define SYS_getwmapinfo 25
+#define SYS_meminfo 26
+#define SYS_pmeminfo 27
+#define SYS_wmapoff 28
+#define SYS_shm_open 29
+#define SYS_shm_unlink 30
+#define SYS_vmtune 31
+#define SYS_faultstat 32
+#define SYS_wprotect 33
+#define SYS_uffd 34
+#define SYS_wcopy 35
+#define SYS_wzero 36
+#define SYS_getwsinfo 37
+#define SYS_checkpoint 38
+#define SYS_restore 39
+#define SYS_zygote 40
+#define SYS_spawn_from 41
+#define SYS_getschedinfo 42
 
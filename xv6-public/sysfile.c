@@ -442,3 +442,178 @@ sys_pipe(void)
   fd[1] = fd1;
   return 0;
 }
+
+// Open the shared-memory object called name, creating it with size
+// bytes if needed. Returns a file descriptor to pass to wmap.
+int
+sys_shm_open(void)
+{
+  char *name;
+  int size, fd;
+  struct file *f;
+
+  if(argstr(0, &name) < 0 || argint(1, &size) < 0)
+    return -1;
+  if(shmopen(name, size, &f) < 0)
+    return -1;
+  if((fd = fdalloc(f)) < 0){
+    fileclose(f);
+    return -1;
+  }
+  return fd;
+}
+
+int
+sys_shm_unlink(void)
+{
+  char *name;
+
+  if(argstr(0, &name) < 0)
+    return -1;
+  return shmunlink(name);
+}
+
+int
+sys_uffd(void)
+{
+  int fd;
+  struct file *f;
+
+  if(uffdopen(&f) < 0)
+    return -1;
+  if((fd = fdalloc(f)) < 0){
+    fileclose(f);
+    return -1;
+  }
+  return fd;
+}
+
+// Whether [va, va+len) lies below the caller's sz or inside one of its
+// wmap regions. Only the caller changes its regions, so no lock is
+// needed to look at them.
+static int
+userrange(uint va, int len)
+{
+  struct proc *p = myproc();
+  struct mmap_region *r;
+  int k;
+
+  if(len < 0 || va + len < va)
+    return 0;
+  if(va + len <= p->sz)
+    return 1;
+  for(k = 0; k < p->num_mmaps; k++){
+    r = &p->mmaps[k];
+    if(va >= r->start_addr && va + len <= r->start_addr + r->length)
+      return 1;
+  }
+  return 0;
+}
+
+// Copy len bytes from src into the pages at addr of the process whose
+// faults the uffd fd handles. src may be in the caller's heap or in
+// one of its wmap regions, where a handler usually keeps page data;
+// uffdfill copies before taking any lock, so src may fault.
+int
+sys_wcopy(void)
+{
+  struct file *f;
+  int addr, len, src;
+
+  if(argfd(0, 0, &f) < 0 || argint(1, &addr) < 0 || argint(2, &src) < 0 ||
+     argint(3, &len) < 0 || !userrange(src, len))
+    return -1;
+  return uffdfill(f, addr, (char*)src, len);
+}
+
+// Like wcopy, with zeroed pages.
+int
+sys_wzero(void)
+{
+  struct file *f;
+  int addr, len;
+
+  if(argfd(0, 0, &f) < 0 || argint(1, &addr) < 0 || argint(2, &len) < 0)
+    return -1;
+  return uffdfill(f, addr, 0, len);
+}
+
+// Save the calling process to path, creating the file if need be.
+int
+sys_checkpoint(void)
+{
+  char *path;
+  struct inode *ip;
+  struct file *f;
+  int r;
+
+  if(argstr(0, &path) < 0)
+    return -1;
+  begin_op();
+  if((ip = create(path, T_FILE, 0, 0)) == 0){
+    end_op();
+    return -1;
+  }
+  if((f = filealloc()) == 0){
+    iunlockput(ip);
+    end_op();
+    return -1;
+  }
+  iunlock(ip);
+  end_op();
+
+  f->type = FD_INODE;
+  f->ip = ip;
+  f->off = 0;
+  f->readable = 0;
+  f->writable = 1;
+  r = checkpoint(f);
+  fileclose(f);
+  return r;
+}
+
+int
+sys_restore(void)
+{
+  char *path;
+
+  if(argstr(0, &path) < 0)
+    return -1;
+  return restore(path);
+}
+
+int
+sys_zygote(void)
+{
+  char *path;
+
+  if(argstr(0, &path) < 0)
+    return -1;
+  return zygote(path);
+}
+
+int
+sys_spawn_from(void)
+{
+  char *argv[MAXARG];
+  int i, id;
+  uint uargv, uarg;
+
+  if(argint(0, &id) < 0 || argint(1, (int*)&uargv) < 0){
+    return -1;
+  }
+  memset(argv, 0, sizeof(argv));
+  for(i=0;; i++){
+    if(i >= NELEM(argv))
+      return -1;
+    if(fetchint(uargv+4*i, (int*)&uarg) < 0)
+      return -1;
+    if(uarg == 0){
+      argv[i] = 0;
+      break;
+    }
+    if(fetchstr(uarg, &argv[i]) < 0)
+      return -1;
+  }
+  return spawn_from(id, argv);
+}
@@ -7,6 +7,7 @@
 #include "mmu.h"
 #include "proc.h"
 #include "wmap.h"
+#include "memstat.h"
 
 int
 sys_fork(void)
@@ -122,7 +123,27 @@ sys_wmap(void)
     return -1;
   }
 
-  return wmap(addr, length, flags, fd);
+  return wmap(addr, length, flags, fd, 0);
+}
+
+// wmap with a file offset, so that a window of a large file can be
+// mapped. offset must be page-aligned.
+int
+sys_wmapoff(void)
+{
+  uint addr;
+  int length;
+  int flags;
+  int fd;
+  uint offset;
+
+  if (argint(0, (int*)&addr) < 0 || argint(1, &length) < 0 ||
+      argint(2, &flags) < 0 || argint(3, &fd) < 0 ||
+      argint(4, (int*)&offset) < 0){
+    return -1;
+  }
+
+  return wmap(addr, length, flags, fd, offset);
 }
 
 // this one is the wunmap system call
@@ -139,6 +160,22 @@ sys_wunmap(void)
   return wunmap(addr);
 }
 
+// the wprotect system call
+int
+sys_wprotect(void)
+{
+  uint addr;
+  int length;
+  int prot;
+
+  if (argint(0, (int*)&addr) < 0 || argint(1, &length) < 0 ||
+      argint(2, &prot) < 0){
+    return FAILED;
+  }
+
+  return wprotect(addr, length, prot);
+}
+
 // the va2pa system call
 int
 sys_va2pa(void)
@@ -155,25 +192,165 @@ int
 sys_getwmapinfo(void)
 {
   struct wmapinfo *uwminfo;
-  struct wmapinfo kwminfo;
-  struct proc *curproc = myproc();
 
   if (argptr(0, (void*)&uwminfo, sizeof(*uwminfo)) < 0){
     return FAILED;
   }
 
-  kwminfo.total_mmaps = curproc->num_mmaps;
-  for (int i = 0; i < kwminfo.total_mmaps; i++) {
-    struct mmap_region *region = &curproc->mmaps[i];
-    kwminfo.addr[i] = region->start_addr;
-    kwminfo.length[i] = region->length;
-    kwminfo.n_loaded_pages[i] = region->loaded_pages;
+  // counts the resident pages from the page table rather than trusting loaded_pages
+  return getwmapinfo(uwminfo);
+}
+
+
+// the meminfo system call: system-wide page counts
+int
+sys_meminfo(void)
+{
+  struct meminfo *umi;
+  struct meminfo mi;
+
+  if (argptr(0, (void*)&umi, sizeof(*umi)) < 0){
+    return FAILED;
   }
 
-  if (copyout(curproc->pgdir, (uint)uwminfo, &kwminfo, sizeof(kwminfo)) < 0) {
+  mi.total_pages = ktotalpages();
+  mi.free_pages = kfreepages();
+  mi.pgtable_pages = pgtablepages();
+  mi.pipe_pages = pipepages();
+  mi.bcache_pages = bcachepages();
+  zramstat(&mi.swap_pages, &mi.zram_bytes);
+  ksmstat(&mi);
+
+  if (copyout(myproc()->pgdir, (uint)umi, &mi, sizeof(mi)) < 0) {
     return FAILED;
   }
 
   return SUCCESS;
 }
 
+// the pmeminfo system call: page counts of one process (0 for the caller)
+int
+sys_pmeminfo(void)
+{
+  int pid;
+  struct pmeminfo *upmi;
+  struct pmeminfo pmi;
+
+  if (argint(0, &pid) < 0 || argptr(1, (void*)&upmi, sizeof(*upmi)) < 0){
+    return FAILED;
+  }
+
+  if (pid == 0){
+    pid = myproc()->pid;
+  }
+
+  if (procmeminfo(pid, &pmi) < 0){
+    return FAILED;
+  }
+
+  if (copyout(myproc()->pgdir, (uint)upmi, &pmi, sizeof(pmi)) < 0) {
+    return FAILED;
+  }
+
+  return SUCCESS;
+}
+
+// the faultstat system call: page-fault counts of one process (0 for
+// the caller), or of all processes since boot (-1)
+int
+sys_faultstat(void)
+{
+  int pid;
+  struct faultstat *ufs;
+  struct faultstat fs;
+
+  if (argint(0, &pid) < 0 || argptr(1, (void*)&ufs, sizeof(*ufs)) < 0){
+    return FAILED;
+  }
+
+  if (pid == 0){
+    pid = myproc()->pid;
+  }
+
+  if (pid == -1){
+    faulttotals(&fs);
+  } else if (procfaultstat(pid, &fs) < 0){
+    return FAILED;
+  }
+
+  if (copyout(myproc()->pgdir, (uint)ufs, &fs, sizeof(fs)) < 0) {
+    return FAILED;
+  }
+
+  return SUCCESS;
+}
+
+// the vmtune system call: read (val < 0) or set a memory daemon knob,
+// returning its old value
+int
+sys_vmtune(void)
+{
+  int knob, val;
+
+  if (argint(0, &knob) < 0 || argint(1, &val) < 0){
+    return FAILED;
+  }
+
+  return vmtune(knob, val);
+}
+
+// the getwsinfo system call: pages of a process (0 for the caller)
+// touched between kidled's last two scans
+int
+sys_getwsinfo(void)
+{
+  int pid;
+  struct wsinfo *uws;
+  struct wsinfo ws;
+
+  if (argint(0, &pid) < 0 || argptr(1, (void*)&uws, sizeof(*uws)) < 0){
+    return FAILED;
+  }
+
+  if (pid == 0){
+    pid = myproc()->pid;
+  }
+
+  if (procwsinfo(pid, &ws) < 0){
+    return FAILED;
+  }
+
+  if (copyout(myproc()->pgdir, (uint)uws, &ws, sizeof(ws)) < 0) {
+    return FAILED;
+  }
+
+  return SUCCESS;
+}
+
+// the getschedinfo system call: how a process (0 for the caller) has
+// been scheduled
+int
+sys_getschedinfo(void)
+{
+  int pid;
+  struct schedinfo *usi;
+  struct schedinfo si;
+
+  if (argint(0, &pid) < 0 || argptr(1, (void*)&usi, sizeof(*usi)) < 0){
+    return FAILED;
+  }
+
+  if (pid == 0){
+    pid = myproc()->pid;
+  }
+
+  if (procschedinfo(pid, &si) < 0){
+    return FAILED;
+  }
+
+  if (copyout(myproc()->pgdir, (uint)usi, &si, sizeof(si)) < 0) {
+    return FAILED;
+  }
+
+  return SUCCESS;
+}
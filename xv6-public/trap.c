@@ -10,6 +10,7 @@
 #include "sleeplock.h"
 #include "fs.h"
 #include "file.h"
+#include "memstat.h"
 
 #ifndef min
 #define min(a, b) ((a) < (b) ? (a) : (b))
@@ -23,6 +24,10 @@ uint ticks;
 
 pte_t *walkpgdir(pde_t *pgdir, const void *va, int alloc);
 
+// Page faults of all processes, kept per CPU so that the fault path
+// never writes a shared counter. Summed by faulttotals.
+static struct faultstat cpufaults[NCPU];
+
 void
 tvinit(void)
 {
@@ -41,6 +46,297 @@ idtinit(void)
   lidt(idt, sizeof(idt));
 }
 
+// Map zeroed pages after va, the anonymous page that was just faulted
+// in at pte, so that filling a fresh region front to back takes a
+// fraction of the traps. The window doubles, up to VM_FAULT_AROUND
+// pages in all, while faults keep landing just past the last window,
+// and drops back to nothing when one doesn't. It stops at the end of
+// the region or of pte's page table, or at a page already mapped.
+static void
+faultaround(struct proc *p, struct mmap_region *region, uint va, pte_t *pte)
+{
+  char *pages[16];
+  uint end;
+  int want, n, got, i;
+
+  if (va == region->nextfault) {
+    region->window = min(region->window ? region->window * 2 : 1, vmknob(VM_FAULT_AROUND) - 1);
+  } else {
+    region->window = 0;
+  }
+
+  end = region->start_addr + PGROUNDUP(region->length);
+  want = min(region->window, (end - va) / PGSIZE - 1);
+  want = min(want, NPTENTRIES - 1 - PTX(va));
+
+  n = 0;
+  while (n < want) {
+    got = kalloc_zeroed_batch(pages, min(want - n, NELEM(pages)));
+    for (i = 0; i < got; i++) {
+      pte_t *next = pte + 1 + n;
+      if (n == want || *next) {
+        kfree(pages[i]);
+        want = n;
+        continue;
+      }
+      *next = V2P(pages[i]) | PTE_P | PTE_U;
+      if (pagewritable(region, va + (n + 1) * PGSIZE)) {
+        *next |= PTE_W;
+      }
+      incr_ref_count(V2P(pages[i]));
+      n++;
+    }
+    if (got == 0) {
+      break;
+    }
+  }
+
+  region->loaded_pages += n;
+  region->nextfault = va + (n + 1) * PGSIZE;
+  p->faults.around += n;
+  pushcli();
+  cpufaults[cpuid()].around += n;
+  popcli();
+}
+
+// Handle a page fault at fault_addr in p: swap-in, copy-on-write, or lazy
+// allocation inside one of p's wmap regions. write is set if the
+// access was a write. Called with p->mmlock held; the lock is
+// dropped while a file-backed page is read in or a uffd handler is
+// waited for. Returns how the fault was served, one of the FAULT_
+// types.
+static int
+pagefault(struct proc *p, uint fault_addr, int write)
+{
+  // walk the page directory and get the page table entry
+  pte_t *pte = walkpgdir(p->pgdir, (void *)fault_addr, 0);
+
+  // swapped out by kswapd: bring it back
+  if (pte && !(*pte & PTE_P) && (*pte & PTE_SWAP)) {
+    if (swapin(pte) < 0) {
+      cprintf("trap: out of memory for swap-in\n");
+      p->killed = 1;
+      return FAULT_FAIL;
+    }
+    lcr3(V2P(p->pgdir));
+    return FAULT_SWAPIN;
+  }
+
+  // if the page is marked copy on write
+  // changed the start of the if statement
+  if (pte && (*pte & PTE_P) && (*pte & PTE_COW)) {
+  // if (pte && (*pte & PTE_COW)) {
+    uint pa = PTE_ADDR(*pte);
+
+    // nobody else maps the page any more (the other side of a fork
+    // already broke away, or it is a MAP_PRIVATE file page that was
+    // only read so far), so it can simply be made writable
+    if (get_ref_count(pa) == 1) {
+      *pte = (*pte | PTE_W) & ~PTE_COW;
+      lcr3(V2P(p->pgdir));
+      return FAULT_COWREUSE;
+    }
+
+    char *mem = kalloc();
+
+    if (!mem) {
+      cprintf("trap: out of memory for copy-on-write\n");
+      p->killed = 1;
+      return FAULT_FAIL;
+    }
+
+    // if the child wants to write, then copy the contents of the og page to the new page
+    memmove(mem, (char *)P2V(pa), PGSIZE);
+
+    *pte = V2P(mem) | PTE_P | PTE_W | PTE_U;
+
+    // increment reference count for the new page
+    incr_ref_count(V2P(mem));
+
+    // decrement the reference count of the original page
+    if (decr_ref_count(pa) == 0) {
+      kfree((char *)P2V(pa));
+    }
+
+    // moved it down
+    lcr3(V2P(p->pgdir));
+
+    return FAULT_COW;
+  }
+
+  // handle invalid writes to read only pages
+  if (pte && (*pte & PTE_P) && !(*pte & PTE_W)) {
+    cprintf("Segmentation Fault\n");
+    p->killed = 1;
+    return FAULT_SEGV;
+  }
+
+  // handle lazy allocation
+  for (int i = 0; i < p->num_mmaps; i++) {
+
+    struct mmap_region *region = &p->mmaps[i];
+
+    // check if the fault address falls within the region
+    if (fault_addr >= region->start_addr && fault_addr < region->start_addr + region->length) {
+
+      // wprotect made the page read-only; reads map it without PTE_W
+      int writable = pagewritable(region, fault_addr);
+      if (write && !writable) {
+        cprintf("Segmentation Fault\n");
+        p->killed = 1;
+        return FAULT_SEGV;
+      }
+
+      // a uffd handler supplies the page. uffdwait drops mmlock
+      // while it sleeps; the access is retried on return, and faults
+      // again if the handler mapped some other page.
+      if (region->uffd) {
+        int r = uffdwait(region->uffd, p, PGROUNDDOWN(fault_addr));
+        acquire(&p->mmlock);
+        if (r < 0) {
+          cprintf("trap: no uffd handler for 0x%x\n", fault_addr);
+          p->killed = 1;
+          return FAULT_FAIL;
+        }
+        return FAULT_UFFD;
+      }
+
+      // a shared-memory object already has the page (or makes it
+      // now); map it rather than a new one. MAP_PRIVATE maps get
+      // the page copy-on-write.
+      if (region->f && region->f->type == FD_SHM) {
+        uint pgidx = (region->offset + PGROUNDDOWN(fault_addr) - region->start_addr) / PGSIZE;
+        uint pa = shmpage(region->f->shm, pgidx);
+        if (!pa) {
+          cprintf("Lazy allocation failed: shm page %d\n", pgidx);
+          p->killed = 1;
+          return FAULT_FAIL;
+        }
+        pte_t *pte = walkpgdir(p->pgdir, (void *)PGROUNDDOWN(fault_addr), 1);
+        if (!pte) {
+          cprintf("Lazy allocation failed: page table alloc failed\n");
+          if (decr_ref_count(pa) == 0) {
+            kfree(P2V(pa));
+          }
+          p->killed = 1;
+          return FAULT_FAIL;
+        }
+        if (!writable) {
+          *pte = pa | PTE_P | PTE_U;
+        } else if (region->flags & MAP_PRIVATE) {
+          *pte = pa | PTE_P | PTE_U | PTE_COW;
+        } else {
+          *pte = pa | PTE_P | PTE_W | PTE_U;
+        }
+        region->loaded_pages++;
+        lcr3(V2P(p->pgdir));
+        return FAULT_SHM;
+      }
+
+      // zeroed, so the part of the page past the end of the file reads as 0
+      char *mem = kalloc_zeroed();
+      if (!mem) {
+        cprintf("Lazy allocation failed: out of memory\n");
+        p->killed = 1;
+        return FAULT_FAIL;
+      }
+
+      // check if the mapping is file-backed. readi can sleep, so
+      // mmlock is dropped around it. only p itself adds or removes
+      // regions, so region is still valid afterwards.
+      if (region->f) {
+        struct file *f = region->f;
+        uint pgoff = PGROUNDDOWN(fault_addr) - region->start_addr;
+        uint file_offset = region->offset + pgoff;
+        int bytes_to_read = min(PGSIZE, region->length - pgoff);
+        int n = 0;
+
+        release(&p->mmlock);
+        ilock(f->ip);
+        // a window may run past the end of the file; the rest stays zero
+        if (file_offset >= f->ip->size) {
+          bytes_to_read = 0;
+        } else if (file_offset + bytes_to_read > f->ip->size) {
+          bytes_to_read = f->ip->size - file_offset;
+        }
+        if (bytes_to_read > 0) {
+          n = readi(f->ip, mem, file_offset, bytes_to_read);
+        }
+        iunlock(f->ip);
+        acquire(&p->mmlock);
+
+        // read the file content into memory
+        if (n != bytes_to_read) {
+          cprintf("Lazy allocation failed: file read error\n");
+          kfree(mem);
+          p->killed = 1;
+          return FAULT_FAIL;
+        }
+      }
+
+      // use walkpgdir to ensure that the page table exists
+      pte_t *pte = walkpgdir(p->pgdir, (void *)PGROUNDDOWN(fault_addr), 1);
+      if (!pte) {
+        cprintf("Lazy allocation failed: page table alloc failed\n");
+        kfree(mem);
+        p->killed = 1;
+        return FAULT_FAIL;
+      }
+
+      // somebody else filled the page while the lock was dropped
+      if (*pte & PTE_P) {
+        kfree(mem);
+        return region->f ? FAULT_FILE : FAULT_ANON;
+      }
+
+      // map the allocated page at the fault address. a MAP_PRIVATE
+      // file page that was only read is mapped copy-on-write, so
+      // that the first write turns it into the process's own copy
+      // (see above) and it is never written back.
+      if (!writable) {
+        *pte = V2P(mem) | PTE_P | PTE_U;
+      } else if ((region->flags & MAP_PRIVATE) && region->f && !write) {
+        *pte = V2P(mem) | PTE_P | PTE_U | PTE_COW;
+      } else {
+        *pte = V2P(mem) | PTE_P | PTE_W | PTE_U;
+      }
+
+      // increment the loaded page count in the region
+      region->loaded_pages++;
+      incr_ref_count(V2P(mem));
+
+      if (!region->f) {
+        faultaround(p, region, PGROUNDDOWN(fault_addr), pte);
+      }
+
+      lcr3(V2P(p->pgdir));
+
+      return region->f ? FAULT_FILE : FAULT_ANON;
+    }
+  }
+
+  // if no matching mapping is found, then its an invalid accesss
+  cprintf("Segmentation Fault\n");
+  p->killed = 1;
+  return FAULT_SEGV;
+}
+
+// Page faults of all processes since boot.
+void
+faulttotals(struct faultstat *fs)
+{
+  int i, t;
+
+  memset(fs, 0, sizeof(*fs));
+  for(i = 0; i < NCPU; i++){
+    for(t = 0; t < NFAULT; t++){
+      fs->count[t] += cpufaults[i].count[t];
+      fs->cycles[t] += cpufaults[i].cycles[t];
+    }
+    fs->around += cpufaults[i].around;
+  }
+}
+
 //PAGEBREAK: 41
 void
 trap(struct trapframe *tf)
@@ -99,139 +395,19 @@ trap(struct trapframe *tf)
       panic("trap");
     }
 
-    // walk the page directory and get the page table entry
-    pte_t *pte = walkpgdir(p->pgdir, (void *)fault_addr, 0);
-
-    // if the page is marked copy on write
-    // changed the start of the if statement
-    if (pte && (*pte & PTE_P) && (*pte & PTE_COW)) {
-    // if (pte && (*pte & PTE_COW)) {
-      uint pa = PTE_ADDR(*pte);
-      char *mem = kalloc();
-
-      if (!mem) {
-        cprintf("trap: out of memory for copy-on-write\n");
-        p->killed = 1;
-        return;
-      }
-
-      // if the child wants to write, then copy the contents of the og page to the new page
-      memmove(mem, (char *)P2V(pa), PGSIZE);
-
-      *pte = V2P(mem) | PTE_P | PTE_W | PTE_U;
-
-      // increment reference count for the new page
-      incr_ref_count(V2P(mem) / PGSIZE);
-
-      // decrement the reference count of the original page
-      decr_ref_count(pa / PGSIZE);
-      if (get_ref_count(pa / PGSIZE) == 0) {
-        kfree((char *)P2V(pa));
-      }
-
-      // moved it down
-      lcr3(V2P(p->pgdir));
-
-      return;
-    }
-
-    // handle invalid writes to read only pages
-    if (pte && (*pte & PTE_P) && !(*pte & PTE_W)) {
-      cprintf("Segmentation Fault\n");
-      p->killed = 1;
-      return;
-    }
-
-    // handle lazy allocation
-    for (int i = 0; i < p->num_mmaps; i++) {
-
-      struct mmap_region *region = &p->mmaps[i];
-
-      // check if the fault address falls within the region
-      if (fault_addr >= region->start_addr && fault_addr < region->start_addr + region->length) {
-
-        // ADDED THIS TO HANDLE ANONYMOUS MAPPING
-        if (region->flags & MAP_ANONYMOUS) {
-          char *mem = kalloc();
-          if (!mem) {
-            cprintf("Lazy allocation failed: out of memory\n");
-            p->killed = 1;
-            return;
-          }
-
-          memset(mem, 0, PGSIZE);
-
-          pte_t *pte = walkpgdir(p->pgdir, (void *)PGROUNDDOWN(fault_addr), 1);
-          if (!pte) {
-            cprintf("Lazy allocation failed: page table alloc failed\n");
-            kfree(mem);
-            p->killed = 1;
-            return;
-          }
-
-          *pte = V2P(mem) | PTE_P | PTE_W | PTE_U;
-
-          region->loaded_pages++;
-          incr_ref_count(V2P(mem) / PGSIZE);
-
-          lcr3(V2P(p->pgdir));
-
-          return;
-        }
-
-
-        char *mem = kalloc();
-        if (!mem) {
-          cprintf("Lazy allocation failed: out of memory\n");
-          p->killed = 1;
-          return;
-        }
-
-        // zero out the allocated pages
-        memset(mem, 0, PGSIZE);
-
-        // check if the mapping is file-backed
-        if (region->f) {
-          int file_offset = fault_addr - region->start_addr;
-          int bytes_to_read = min(PGSIZE, region->length - file_offset);
-
-          ilock(region->f->ip);
-          int n = readi(region->f->ip, mem, file_offset, bytes_to_read);
-          iunlock(region->f->ip);
-
-          // read the file content into memory
-          if (n != bytes_to_read) {
-            cprintf("Lazy allocation failed: file read error\n");
-            kfree(mem);
-            p->killed = 1;
-            return;
-          }
-
-        }
-
-        // use walkpgdir to ensure that the page table exists
-        pte_t *pte = walkpgdir(p->pgdir, (void *)PGROUNDDOWN(fault_addr), 1);
-        if (!pte) {
-          cprintf("Lazy allocation failed: page table alloc failed\n");
-          kfree(mem);
-          p->killed = 1;
-          return;
-        }
-
-        // map the allocated page at the fault address
-        *pte = V2P(mem) | PTE_P | PTE_W | PTE_U;
-
-        // increment the loaded page count in the region
-        region->loaded_pages++;
-        incr_ref_count(V2P(mem) / PGSIZE);
-
-        return;
-      }
-    }
-
-    // if no matching mapping is found, then its an invalid accesss
-    cprintf("Segmentation Fault\n");
-    p->killed = 1;
+    // count the fault by type, for the process and for the CPU
+    uint64 start = rdtsc();
+    acquire(&p->mmlock);
+    int type = pagefault(p, fault_addr, tf->err & 2);
+    uint64 cycles = rdtsc() - start;
+    p->faults.count[type]++;
+    p->faults.cycles[type] += cycles;
+    release(&p->mmlock);
+
+    pushcli();
+    cpufaults[cpuid()].count[type]++;
+    cpufaults[cpuid()].cycles[type] += cycles;
+    popcli();
     return;
   }
  
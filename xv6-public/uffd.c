@@ -0,0 +1,253 @@
+// User-level fault handling for wmap regions.
+//
+// uffd() returns a file descriptor for a fault queue. An anonymous
+// region mapped with MAP_UFFD and that descriptor is registered with
+// it: a fault on a page of the region that is not there yet puts the
+// address on the queue and sleeps, instead of zero-filling. A handler
+// process (typically a child that inherited the descriptor) reads the
+// addresses, one uint per read, and supplies each page with wcopy or
+// wzero, which map it into the registered process and wake it.
+//
+// Only the process that created the queue can register regions with
+// it; fork does not carry the registration over to the child. Once
+// the last descriptor is closed, faults on registered regions kill
+// the process, and once no region is registered any more, reads
+// return 0.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "fs.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "file.h"
+
+pte_t *walkpgdir(pde_t *pgdir, const void *va, int alloc);
+
+#define NUFFD   8
+#define UFFDQ   16      // faults queued per uffd
+
+struct uffd {
+  int used;
+  int pid;              // process whose regions can be registered
+  int nreg;             // regions registered
+  int closed;           // no descriptor is left
+  uint queue[UFFDQ];    // faulting page addresses not yet read
+  uint head, tail;
+  uint nresolved;       // pages mapped by wcopy and wzero
+};
+
+struct {
+  struct spinlock lock; // protects all the uffds
+  struct uffd uffd[NUFFD];
+} ufftable;
+
+void
+uffdinit(void)
+{
+  initlock(&ufftable.lock, "uffd");
+}
+
+// Make a new fault queue for the calling process and a file for it.
+int
+uffdopen(struct file **fp)
+{
+  struct uffd *u;
+  struct file *f;
+
+  if((f = filealloc()) == 0)
+    return -1;
+  acquire(&ufftable.lock);
+  for(u = ufftable.uffd; u < &ufftable.uffd[NUFFD]; u++)
+    if(!u->used)
+      break;
+  if(u == &ufftable.uffd[NUFFD]){
+    release(&ufftable.lock);
+    fileclose(f);
+    return -1;
+  }
+  memset(u, 0, sizeof(*u));
+  u->used = 1;
+  u->pid = myproc()->pid;
+  release(&ufftable.lock);
+
+  f->type = FD_UFFD;
+  f->uffd = u;
+  f->readable = 1;
+  f->writable = 0;
+  *fp = f;
+  return 0;
+}
+
+// Register a region of the calling process with u.
+int
+uffdreg(struct uffd *u)
+{
+  int r;
+
+  acquire(&ufftable.lock);
+  r = -1;
+  if(u->pid == myproc()->pid){
+    u->nreg++;
+    r = 0;
+  }
+  release(&ufftable.lock);
+  return r;
+}
+
+// A registered region went away.
+void
+uffdunreg(struct uffd *u)
+{
+  acquire(&ufftable.lock);
+  if(--u->nreg == 0){
+    if(u->closed)
+      u->used = 0;
+    wakeup(&u->head);
+  }
+  release(&ufftable.lock);
+}
+
+// The last file referring to u was closed.
+void
+uffdclose(struct uffd *u)
+{
+  acquire(&ufftable.lock);
+  u->closed = 1;
+  if(u->nreg == 0)
+    u->used = 0;
+  wakeup(&u->nresolved);
+  release(&ufftable.lock);
+}
+
+// Queue a fault of p at page va and sleep until wcopy or wzero maps
+// some page. Called with p->mmlock held, which is released and not
+// retaken. Returns -1 if no handler is left or p was killed.
+int
+uffdwait(struct uffd *u, struct proc *p, uint va)
+{
+  uint i, seq;
+
+  // a page mapped after p's fault is counted after this read, since
+  // mapping it needs p->mmlock; so the sleep below can't miss it. The
+  // read is unlocked so that ufftable.lock is never taken under
+  // mmlock.
+  seq = u->nresolved;
+  release(&p->mmlock);
+
+  acquire(&ufftable.lock);
+  if(u->closed){
+    release(&ufftable.lock);
+    return -1;
+  }
+  for(i = u->head; i != u->tail; i++)
+    if(u->queue[i % UFFDQ] == va)
+      break;
+  // a full queue drops the event; the fault comes back after the
+  // handler has caught up
+  if(i == u->tail && u->tail - u->head < UFFDQ){
+    u->queue[u->tail++ % UFFDQ] = va;
+    wakeup(&u->head);
+  }
+  while(u->nresolved == seq && !u->closed && !p->killed)
+    sleep(&u->nresolved, &ufftable.lock);
+  i = u->closed || p->killed;
+  release(&ufftable.lock);
+  return i ? -1 : 0;
+}
+
+// Read the next faulting address into addr.
+int
+uffdread(struct uffd *u, char *addr, int n)
+{
+  uint va;
+
+  if(n < sizeof(va))
+    return -1;
+  acquire(&ufftable.lock);
+  while(u->head == u->tail){
+    if(u->nreg == 0){
+      release(&ufftable.lock);
+      return 0;
+    }
+    if(myproc()->killed){
+      release(&ufftable.lock);
+      return -1;
+    }
+    sleep(&u->head, &ufftable.lock);
+  }
+  va = u->queue[u->head++ % UFFDQ];
+  release(&ufftable.lock);
+  memmove(addr, &va, sizeof(va));
+  return sizeof(va);
+}
+
+// Map mem at va in u's process, in a region registered with u where
+// nothing is mapped yet. Returns -1 if it can't, and mem is not used.
+static int
+uffdmap(struct uffd *u, uint va, char *mem)
+{
+  struct mmap_region *r;
+  struct proc *p;
+  pte_t *pte;
+  int i;
+
+  if((p = lockpid(u->pid)) == 0)
+    return -1;
+  r = 0;
+  for(i = 0; i < p->num_mmaps; i++){
+    r = &p->mmaps[i];
+    if(va >= r->start_addr && va < r->start_addr + r->length)
+      break;
+  }
+  // a page that isn't mapped can't be in any TLB, so there is nothing
+  // to flush even if p is running
+  if(i == p->num_mmaps || r->uffd != u ||
+     (pte = walkpgdir(p->pgdir, (void*)va, 1)) == 0 || (*pte & (PTE_P|PTE_SWAP))){
+    unlockmm(p);
+    return -1;
+  }
+  *pte = V2P(mem) | PTE_P | PTE_U;
+  if(pagewritable(r, va))
+    *pte |= PTE_W;
+  incr_ref_count(V2P(mem));
+  r->loaded_pages++;
+  unlockmm(p);
+
+  acquire(&ufftable.lock);
+  u->nresolved++;
+  wakeup(&u->nresolved);
+  release(&ufftable.lock);
+  return 0;
+}
+
+// Map len bytes at va in f's process, copied from src in the caller's
+// memory or zeroed if src is 0. Returns the number of bytes mapped,
+// or -1 if not even the first page could be.
+int
+uffdfill(struct file *f, uint va, char *src, int len)
+{
+  char *mem;
+  int n;
+
+  if(f->type != FD_UFFD || va % PGSIZE || len <= 0 || len % PGSIZE)
+    return -1;
+  for(n = 0; n < len; n += PGSIZE){
+    // the copy can fault, so it is done before any lock is taken
+    if(src){
+      if((mem = kalloc()) == 0)
+        break;
+      memmove(mem, src + n, PGSIZE);
+    } else if((mem = kalloc_zeroed()) == 0){
+      break;
+    }
+    if(uffdmap(f->uffd, va + n, mem) < 0){
+      kfree(mem);
+      break;
+    }
+  }
+  return n > 0 ? n : -1;
+}
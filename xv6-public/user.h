@@ -1,4 +1,6 @@
 #include "wmap.h"
+#include "memstat.h"
+#include "schedstat.h"
 
 struct stat;
 struct rtcdate;
@@ -27,9 +29,26 @@ int sleep(int);
 int uptime(void);
 // added the system call here
 uint wmap(uint addr, int length, int flags, int fd);
+uint wmapoff(uint addr, int length, int flags, int fd, uint offset);
 int wunmap(uint addr);
+int wprotect(uint addr, int length, int prot);
 uint va2pa(uint va);
 int getwmapinfo(struct wmapinfo *wminfo);
+int meminfo(struct meminfo *mi);
+int pmeminfo(int pid, struct pmeminfo *pmi);
+int shm_open(char *name, int size);
+int shm_unlink(char *name);
+int vmtune(int knob, int val);
+int faultstat(int pid, struct faultstat *fs);
+int uffd(void);
+int wcopy(int fd, uint addr, void *src, int len);
+int wzero(int fd, uint addr, int len);
+int getwsinfo(int pid, struct wsinfo *ws);
+int checkpoint(char *path);
+int restore(char *path);
+int zygote(char *path);
+int spawn_from(int id, char **argv);
+int getschedinfo(int pid, struct schedinfo *si);
 
 
 // ulib.c
@@ -11,9 +11,42 @@
 #include "sleeplock.h"
 #include "fs.h"
 #include "file.h"
+#include "memstat.h"
 
-#define MAX_PAGES (PHYSTOP / PGSIZE)
-static uchar ref_counts[MAX_PAGES];
+// Page-table pages (directories included) in use, for meminfo. The
+// kernel's own page table is built before mpinit, when neither
+// cpuid() nor a spinlock works yet, so it is a locked add instead.
+static volatile int ptpages;
+
+static void
+ptpagecount(int n)
+{
+  atomicadd(&ptpages, n);
+}
+
+// Knobs of the memory daemons, read with vmknob and set with the
+// vmtune system call. Values outside [min, max] are refused.
+static struct {
+  int val;
+  int min;
+  int max;
+} vmtunable[NVMTUNE] = {
+  [VM_FLUSH_INTERVAL] { 100, 1, 100000 },
+  [VM_DIRTY_EXPIRE]   { 300, 0, 100000 },
+  [VM_DIRTY_RATIO]    { 10,  0, 100 },
+  [VM_SWAP_INTERVAL]  { 10,  1, 100000 },
+  [VM_SWAP_LOW]       { 5,   0, 100 },
+  [VM_SWAP_HIGH]      { 10,  0, 100 },
+  [VM_KSM_INTERVAL]   { 0,   0, 100000 },
+  [VM_THP_INTERVAL]   { 100, 0, 100000 },
+  [VM_FAULT_AROUND]   { 16,  1, NPTENTRIES },
+  [VM_IDLE_INTERVAL]  { 100, 0, 100000 },
+};
+
+// Page reference counts are shared between processes (copy-on-write
+// and MAP_SHARED pages), which no longer run their faults and forks
+// under one global lock, so updates go through reflock.
+static struct spinlock reflock;
 
 #ifndef min
 #define min(a, b) ((a) < (b) ? (a) : (b))
@@ -41,9 +74,33 @@ seginit(void)
   lgdt(c->gdt, sizeof(c->gdt));
 }
 
+// Split the huge user page at pde back into a page table of 1024
+// PTEs with the same flags. Each 4KB page of a huge page keeps its
+// own reference count, so no count changes. Returns -1 if there is
+// no memory for the page table.
+static int
+splitpde(pde_t *pde)
+{
+  pte_t *pgtab;
+  uint pa, flags;
+  int i;
+
+  if((pgtab = (pte_t*)kalloc()) == 0)
+    return -1;
+  ptpagecount(1);
+  pa = PTE_ADDR(*pde);
+  flags = PTE_FLAGS(*pde) & ~PTE_PS;
+  for(i = 0; i < NPTENTRIES; i++)
+    pgtab[i] = (pa + i*PGSIZE) | flags;
+  // the translations are the same, so stale TLB entries are harmless
+  *pde = V2P(pgtab) | PTE_P | PTE_W | PTE_U;
+  return 0;
+}
+
 // Return the address of the PTE in page table pgdir
 // that corresponds to virtual address va.  If alloc!=0,
-// create any required page table pages.
+// create any required page table pages. A huge user page
+// is split first, since the caller wants a PTE.
 pte_t*
 walkpgdir(pde_t *pgdir, const void *va, int alloc)
 {
@@ -51,13 +108,15 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
   pte_t *pgtab;
 
   pde = &pgdir[PDX(va)];
+  if((*pde & PTE_PS) && ((uint)va >= KERNBASE || splitpde(pde) < 0))
+    return 0;
   if(*pde & PTE_P){
     pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
   } else {
-    if(!alloc || (pgtab = (pte_t*)kalloc()) == 0)
-      return 0;
     // Make sure all those PTE_P bits are zero.
-    memset(pgtab, 0, PGSIZE);
+    if(!alloc || (pgtab = (pte_t*)kalloc_zeroed()) == 0)
+      return 0;
+    ptpagecount(1);
     // The permissions here are overly generous, but they can
     // be further restricted by the permissions in the page table
     // entries, if necessary.
@@ -66,34 +125,175 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
   return &pgtab[PTX(va)];
 }
 
-// Create PTEs for virtual addresses starting at va that refer to
-// physical addresses starting at pa. va and size might not
-// be page-aligned.
+// The PTE for va in pgdir, or 0 if it has no page table. Unlike
+// walkpgdir it never allocates, and gives 0 for a huge page rather
+// than splitting it.
+pte_t*
+findpte(pde_t *pgdir, uint va)
+{
+  pde_t *pde;
+
+  pde = &pgdir[PDX(va)];
+  if(!(*pde & PTE_P) || (*pde & PTE_PS))
+    return 0;
+  return &((pte_t*)P2V(PTE_ADDR(*pde)))[PTX(va)];
+}
+
+// Walk the user part of pgdir over [start, end) one page table at a
+// time, skipping the 4MB spans whose page table is absent or that a
+// huge page maps (see hugerange). For each
+// page table that is present, fn gets the run of PTEs it holds for
+// the range: n consecutive entries, the first of which maps va. If fn
+// returns nonzero the walk stops and walkrange returns that value.
+int
+walkrange(pde_t *pgdir, uint start, uint end,
+          int (*fn)(pte_t*, uint, int, void*), void *arg)
+{
+  pde_t *pde;
+  pte_t *pgtab;
+  uint va, next;
+  int r;
+
+  if(end > KERNBASE)
+    end = KERNBASE;
+  end = PGROUNDUP(end);
+  for(va = PGROUNDDOWN(start); va < end; va = next){
+    next = PGADDR(PDX(va) + 1, 0, 0);
+    if(next > end)
+      next = end;
+    pde = &pgdir[PDX(va)];
+    if(!(*pde & PTE_P) || (*pde & PTE_PS))
+      continue;
+    pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
+    if((r = fn(&pgtab[PTX(va)], va, (next - va) / PGSIZE, arg)) != 0)
+      return r;
+  }
+  return 0;
+}
+
+// Get the huge pages overlapping [start, end) out of the way of a
+// walkrange, which skips them. Each is split into a page table or,
+// if free is set and it lies entirely inside the range, freed.
+// Returns -1 if a page table can't be allocated.
 static int
-mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
+hugerange(pde_t *pgdir, uint start, uint end, int free)
 {
-  char *a, *last;
-  pte_t *pte;
+  pde_t *pde;
+  uint va, pa;
+  int i;
 
-  a = (char*)PGROUNDDOWN((uint)va);
-  last = (char*)PGROUNDDOWN(((uint)va) + size - 1);
-  for(;;){
-    if((pte = walkpgdir(pgdir, a, 1)) == 0)
-      return -1;
-    if(*pte & PTE_P)
-      panic("remap");
-    *pte = pa | perm | PTE_P;
-    if(a == last)
-      break;
-    a += PGSIZE;
-    pa += PGSIZE;
+  if(end > KERNBASE)
+    end = KERNBASE;
+  end = PGROUNDUP(end);
+  for(va = start & ~(HUGEPGSIZE-1); va < end; va += HUGEPGSIZE){
+    pde = &pgdir[PDX(va)];
+    if(!(*pde & PTE_PS))
+      continue;
+    if(!free || va < start || va + HUGEPGSIZE > end){
+      if(splitpde(pde) < 0)
+        return -1;
+      continue;
+    }
+    pa = PTE_ADDR(*pde);
+    *pde = 0;
+    for(i = 0; i < NPTENTRIES; i++, pa += PGSIZE)
+      if(decr_ref_count(pa) == 0)
+        kfree(P2V(pa));
   }
   return 0;
 }
 
-//same function as mappages but non static
+#define HUGEORDER (PDXSHIFT - PTXSHIFT)
+
+// Replace the page table mapping the 4MB span at va of p with one
+// huge page, if all 1024 of its pages are present, writable user
+// pages that no other page table maps. Returns 1 if the span was
+// collapsed, 0 if it doesn't qualify, no block is free, or it
+// changed while being copied. Caller has p pinned (see pinproc).
+//
+// p->mmlock is held only to check the span, taking a reference to
+// each page, and later to install the copy. The 4MB copy itself is
+// made without it, and is thrown away unless every PTE is as it was
+// (give or take the accessed bits idle.c moves) and no one but p
+// and this copy holds a page.
 int
-mapthepages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
+collapse(struct proc *p, uint va)
+{
+  pde_t *pde, old;
+  pte_t *pgtab, *snap;
+  char *mem;
+  uint pa;
+  int i, ok;
+
+  if(va >= KERNBASE)
+    return 0;
+  if((snap = (pte_t*)kalloc()) == 0)
+    return 0;
+  if((mem = kalloc_pages(HUGEORDER)) == 0){
+    kfree((char*)snap);
+    return 0;
+  }
+
+  acquire(&p->mmlock);
+  pde = &p->pgdir[PDX(va)];
+  old = *pde;
+  ok = (old & PTE_P) && !(old & PTE_PS);
+  pgtab = (pte_t*)P2V(PTE_ADDR(old));
+  for(i = 0; ok && i < NPTENTRIES; i++){
+    snap[i] = pgtab[i];
+    if((snap[i] & (PTE_P|PTE_W|PTE_U|PTE_COW)) != (PTE_P|PTE_W|PTE_U) ||
+       get_ref_count(PTE_ADDR(snap[i])) != 1)
+      ok = 0;
+  }
+  for(i = 0; ok && i < NPTENTRIES; i++)
+    incr_ref_count(PTE_ADDR(snap[i]));
+  release(&p->mmlock);
+  if(!ok){
+    kfree_pages(mem, HUGEORDER);
+    kfree((char*)snap);
+    return 0;
+  }
+
+  for(i = 0; i < NPTENTRIES; i++)
+    memmove(mem + i*PGSIZE, P2V(PTE_ADDR(snap[i])), PGSIZE);
+
+  acquire(&p->mmlock);
+  ok = *pde == old;
+  for(i = 0; ok && i < NPTENTRIES; i++)
+    if((pgtab[i] ^ snap[i]) & ~(PTE_A|PTE_YOUNG) ||
+       get_ref_count(PTE_ADDR(snap[i])) != 2)
+      ok = 0;
+  if(ok){
+    for(i = 0; i < NPTENTRIES; i++)
+      incr_ref_count(V2P(mem) + i*PGSIZE);
+    *pde = V2P(mem) | PTE_P | PTE_W | PTE_U | PTE_PS;
+  }
+  release(&p->mmlock);
+
+  // Drop the references taken above and, if the copy went in, the
+  // old page table's too.
+  for(i = 0; i < NPTENTRIES; i++){
+    pa = PTE_ADDR(snap[i]);
+    if(ok)
+      decr_ref_count(pa);
+    if(decr_ref_count(pa) == 0)
+      kfree(P2V(pa));
+  }
+  if(ok){
+    kfree((char*)pgtab);
+    ptpagecount(-1);
+  } else {
+    kfree_pages(mem, HUGEORDER);
+  }
+  kfree((char*)snap);
+  return ok;
+}
+
+// Create PTEs for virtual addresses starting at va that refer to
+// physical addresses starting at pa. va and size might not
+// be page-aligned.
+static int
+mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
 {
   char *a, *last;
   pte_t *pte;
@@ -127,16 +327,22 @@ mapthepages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
 //   KERNBASE..KERNBASE+EXTMEM: mapped to 0..EXTMEM (for I/O space)
 //   KERNBASE+EXTMEM..data: mapped to EXTMEM..V2P(data)
 //                for the kernel's instructions and r/o data
-//   data..KERNBASE+PHYSTOP: mapped to V2P(data)..PHYSTOP,
+//   data..KERNBASE+phystop: mapped to V2P(data)..phystop,
 //                                  rw data + free physical memory
 //   0xfe000000..0: mapped direct (devices such as ioapic)
 //
 // The kernel allocates physical memory for its heap and for user memory
-// between V2P(end) and the end of physical memory (PHYSTOP)
-// (directly addressable from end..P2V(PHYSTOP)).
+// between V2P(end) and the end of physical memory (phystop, sized at
+// boot by kinit1) (directly addressable from end..P2V(phystop)).
+//
+// The kernel part is built once, in kpgdir, using 4MB pages wherever
+// possible. Every other page table shares kpgdir's kernel page tables
+// by copying its page directory entries above KERNBASE, so a process
+// costs no extra page-table pages for the kernel however much memory
+// there is.
 
 // This table defines the kernel's mappings, which are present in
-// every process's page table.
+// every process's page table. kmap[2]'s end is set to phystop at boot.
 static struct kmap {
   void *virt;
   uint phys_start;
@@ -149,6 +355,29 @@ static struct kmap {
  { (void*)DEVSPACE, DEVSPACE,      0,         PTE_W}, // more devices
 };
 
+// Map size bytes at va to pa in the kernel part of pgdir, using a
+// 4MB page wherever va, pa and the remaining size allow it.
+static int
+mapkernel(pde_t *pgdir, uint va, uint size, uint pa, int perm)
+{
+  uint n;
+
+  while(size > 0){
+    if(va % HUGEPGSIZE == 0 && pa % HUGEPGSIZE == 0 && size >= HUGEPGSIZE){
+      pgdir[PDX(va)] = pa | perm | PTE_P | PTE_PS;
+      n = HUGEPGSIZE;
+    } else {
+      if(mappages(pgdir, (void*)va, PGSIZE, pa, perm) < 0)
+        return -1;
+      n = PGSIZE;
+    }
+    va += n;
+    pa += n;
+    size -= n;
+  }
+  return 0;
+}
+
 // Set up kernel part of a page table.
 pde_t*
 setupkvm(void)
@@ -156,17 +385,24 @@ setupkvm(void)
   pde_t *pgdir;
   struct kmap *k;
 
-  if((pgdir = (pde_t*)kalloc()) == 0)
+  if((pgdir = (pde_t*)kalloc_zeroed()) == 0)
     return 0;
-  memset(pgdir, 0, PGSIZE);
-  if (P2V(PHYSTOP) > (void*)DEVSPACE)
-    panic("PHYSTOP too high");
+  ptpagecount(1);
+
+  if(kpgdir){
+    memmove(&pgdir[PDX(KERNBASE)], &kpgdir[PDX(KERNBASE)],
+            (NPDENTRIES - PDX(KERNBASE)) * sizeof(pde_t));
+    return pgdir;
+  }
+
+  // First call, from kvmalloc: build the kernel mappings.
+  kmap[2].phys_end = phystop;
+  if (P2V(phystop) > (void*)DEVSPACE)
+    panic("phystop too high");
   for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
-    if(mappages(pgdir, k->virt, k->phys_end - k->phys_start,
-                (uint)k->phys_start, k->perm) < 0) {
-      freevm(pgdir);
-      return 0;
-    }
+    if(mapkernel(pgdir, (uint)k->virt, k->phys_end - k->phys_start,
+                 (uint)k->phys_start, k->perm) < 0)
+      panic("setupkvm");
   return pgdir;
 }
 
@@ -175,6 +411,7 @@ setupkvm(void)
 void
 kvmalloc(void)
 {
+  initlock(&reflock, "pageref");
   kpgdir = setupkvm();
   switchkvm();
 }
@@ -221,8 +458,7 @@ inituvm(pde_t *pgdir, char *init, uint sz)
 
   if(sz >= PGSIZE)
     panic("inituvm: more than a page");
-  mem = kalloc();
-  memset(mem, 0, PGSIZE);
+  mem = kalloc_zeroed();
   mappages(pgdir, 0, PGSIZE, V2P(mem), PTE_W|PTE_U);
   memmove(mem, init, sz);
 }
@@ -277,24 +513,45 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 
   a = PGROUNDUP(oldsz);
   for(; a < newsz; a += PGSIZE){
-    mem = kalloc();
+    mem = kalloc_zeroed();
     if(mem == 0){
       cprintf("allocuvm out of memory\n");
       deallocuvm(pgdir, newsz, oldsz);
       return 0;
     }
-    memset(mem, 0, PGSIZE);
     if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
       cprintf("allocuvm out of memory (2)\n");
       deallocuvm(pgdir, newsz, oldsz);
       kfree(mem);
       return 0;
     }
-    incr_ref_count(V2P(mem) / PGSIZE);
+    incr_ref_count(V2P(mem));
   }
   return newsz;
 }
 
+static int
+freefn(pte_t *pte, uint va, int n, void *arg)
+{
+  uint pa;
+
+  for(; n > 0; n--, pte++){
+    if(*pte & PTE_SWAP){
+      swapfree(pte);
+      continue;
+    }
+    if(!(*pte & PTE_P))
+      continue;
+    pa = PTE_ADDR(*pte);
+    if(pa == 0)
+      panic("kfree");
+    if(decr_ref_count(pa) == 0)
+      kfree(P2V(pa));
+    *pte = 0;
+  }
+  return 0;
+}
+
 // Deallocate user pages to bring the process size from oldsz to
 // newsz.  oldsz and newsz need not be page-aligned, nor does newsz
 // need to be less than oldsz.  oldsz can be larger than the actual
@@ -302,30 +559,11 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 int
 deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 {
-  pte_t *pte;
-  uint a, pa;
-
   if(newsz >= oldsz)
     return oldsz;
 
-  a = PGROUNDUP(newsz);
-  for(; a  < oldsz; a += PGSIZE){
-    pte = walkpgdir(pgdir, (char*)a, 0);
-    if(!pte)
-      a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
-    else if((*pte & PTE_P) != 0){
-      pa = PTE_ADDR(*pte);
-      if(pa == 0)
-        panic("kfree");
-
-      decr_ref_count(pa / PGSIZE);
-      if (get_ref_count(pa / PGSIZE) == 0) {
-        char *v = P2V(pa);
-        kfree(v);
-      }
-      *pte = 0;
-    }
-  }
+  hugerange(pgdir, PGROUNDUP(newsz), oldsz, 1);
+  walkrange(pgdir, PGROUNDUP(newsz), oldsz, freefn, 0);
   return newsz;
 }
 
@@ -335,19 +573,24 @@ void
 freevm(pde_t *pgdir)
 {
   uint i;
+  int n;
 
   if(pgdir == 0)
     panic("freevm: no pgdir");
 
   deallocuvm(pgdir, KERNBASE, 0);
 
-  for(i = 0; i < NPDENTRIES; i++){
+  // Page tables above KERNBASE belong to kpgdir.
+  n = 1;
+  for(i = 0; i < PDX(KERNBASE); i++){
     if(pgdir[i] & PTE_P){
       char * v = P2V(PTE_ADDR(pgdir[i]));
       kfree(v);
+      n++;
     }
   }
   kfree((char*)pgdir);
+  ptpagecount(-n);
 }
 
 // Clear PTE_U on a page. Used to create an inaccessible
@@ -377,59 +620,72 @@ is_shared(struct proc *p, uint va) {
   return 0;
 }
 
-// Given a parent process's page table, create a copy
-// of it for a child.
-pde_t*
-copyuvm(pde_t *pgdir, uint sz, struct proc *p)
-{
+struct sharearg {
   pde_t *d;
-  pte_t *pte;
-  uint pa, i, flags;
-
-  if((d = setupkvm()) == 0)
-    return 0;
-
-  for(i = 0; i < sz; i += PGSIZE){
+  int cow;
+};
 
-    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
-      // panic("copyuvm: pte should exist");
-      continue;
+static int
+sharefn(pte_t *pte, uint va, int n, void *arg)
+{
+  struct sharearg *sa = arg;
+  pte_t *pgtab = 0;
 
+  for(; n > 0; n--, pte++, va += PGSIZE){
+    // the child can't share a swap slot; bring the page back first
+    if((*pte & PTE_SWAP) && swapin(pte) < 0)
+      return -1;
     if(!(*pte & PTE_P))
-      // panic("copyuvm: page not present");
       continue;
-    
-    pa = PTE_ADDR(*pte);
-    flags = PTE_FLAGS(*pte);
-
-    if (is_shared(p, i)) {
-      if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0) {
-        goto bad;
-      }
-
-      incr_ref_count(pa / PGSIZE);
+    // the run is inside one page table, so one walk covers it
+    if(pgtab == 0){
+      if((pgtab = walkpgdir(sa->d, (void*)va, 1)) == 0)
+        return -1;
+      pgtab -= PTX(va);
     }
+    if(sa->cow && (*pte & PTE_W))
+      *pte = (*pte & ~PTE_W) | PTE_COW;
+    pgtab[PTX(va)] = *pte;
+    incr_ref_count(PTE_ADDR(*pte));
+  }
+  return 0;
+}
 
-    else {
-      if (flags & PTE_W) {
-        flags &= ~PTE_W;
-        flags |= PTE_COW;
-      }
+// Map the pages present in [start, end) of pgdir into d at the same
+// addresses and with the same flags, so that both share the physical
+// pages. If cow is set, writable pages become copy-on-write in both.
+// Used by fork for wmap regions and, through copyuvm, for the rest
+// of the address space; the caller flushes pgdir's TLB.
+// Returns -1 if d runs out of page-table pages.
+int
+sharerange(pde_t *pgdir, pde_t *d, uint start, uint end, int cow)
+{
+  struct sharearg sa;
 
-      if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0) {
-        goto bad;
-      }
+  // the child shares the pages one by one
+  if(hugerange(pgdir, start, end, 0) < 0)
+    return -1;
+  sa.d = d;
+  sa.cow = cow;
+  return walkrange(pgdir, start, end, sharefn, &sa) < 0 ? -1 : 0;
+}
 
-      incr_ref_count(pa / PGSIZE);
-    }
+// Given a parent process's page table, create a copy of it for a
+// child. The pages below sz are shared copy-on-write by parent and
+// child, in one walkrange like fork's wmap regions; the caller
+// flushes pgdir's TLB. No wmap region lies below sz.
+pde_t*
+copyuvm(pde_t *pgdir, uint sz)
+{
+  pde_t *d;
 
+  if((d = setupkvm()) == 0)
+    return 0;
+  if(sharerange(pgdir, d, 0, sz, 1) < 0){
+    freevm(d);
+    return 0;
   }
-
   return d;
-
-bad:
-  freevm(d);
-  return 0;
 }
 
 //PAGEBREAK!
@@ -437,35 +693,90 @@ bad:
 char*
 uva2ka(pde_t *pgdir, char *uva)
 {
+  pde_t pde;
   pte_t *pte;
 
+  // a huge page has no PTE to look at, and needn't be split for one
+  pde = pgdir[PDX(uva)];
+  if((uint)uva < KERNBASE && (pde & PTE_PS)){
+    if((pde & PTE_U) == 0)
+      return 0;
+    return (char*)P2V(PTE_ADDR(pde) + ((uint)uva & (HUGEPGSIZE-1)));
+  }
   pte = walkpgdir(pgdir, uva, 0);
-  if((*pte & PTE_P) == 0)
+  if(pte == 0 || (*pte & PTE_P) == 0)
     return 0;
   if((*pte & PTE_U) == 0)
     return 0;
   return (char*)P2V(PTE_ADDR(*pte));
 }
 
+// Kernel address of the user page uva of pgdir for writing it, or 0
+// if the page isn't writable. A copy-on-write page is broken first, as
+// a write fault would; written through its kernel address, it would
+// change for everyone who shares it.
+static char*
+uva2kaw(pde_t *pgdir, char *uva)
+{
+  pte_t *pte;
+  char *mem;
+  uint pa;
+
+  if((uint)uva < KERNBASE && (pgdir[PDX(uva)] & PTE_PS))
+    return uva2ka(pgdir, uva);
+  pte = walkpgdir(pgdir, uva, 0);
+  if(pte == 0 || (*pte & (PTE_P|PTE_U)) != (PTE_P|PTE_U))
+    return 0;
+  if(*pte & PTE_W)
+    return (char*)P2V(PTE_ADDR(*pte));
+  if(!(*pte & PTE_COW))
+    return 0;
+
+  pa = PTE_ADDR(*pte);
+  if(get_ref_count(pa) == 1){
+    *pte = (*pte | PTE_W) & ~PTE_COW;
+  } else {
+    if((mem = kalloc()) == 0)
+      return 0;
+    memmove(mem, P2V(pa), PGSIZE);
+    *pte = V2P(mem) | (PTE_FLAGS(*pte) & ~PTE_COW) | PTE_W;
+    incr_ref_count(V2P(mem));
+    if(decr_ref_count(pa) == 0)
+      kfree(P2V(pa));
+  }
+  if(myproc() && myproc()->pgdir == pgdir)
+    invlpg(uva);
+  return (char*)P2V(PTE_ADDR(*pte));
+}
+
 // Copy len bytes from p to user address va in page table pgdir.
 // Most useful when pgdir is not the current page table.
-// uva2ka ensures this only works for PTE_U pages.
+// uva2kaw ensures this only works for writable PTE_U pages.
 int
 copyout(pde_t *pgdir, uint va, void *p, uint len)
 {
   char *buf, *pa0;
   uint n, va0;
+  struct proc *curproc = myproc();
+  int locked;
 
+  // the caller's own page table is under its mmlock, like a fault
+  locked = curproc && curproc->pgdir == pgdir;
   buf = (char*)p;
   while(len > 0){
     va0 = (uint)PGROUNDDOWN(va);
-    pa0 = uva2ka(pgdir, (char*)va0);
-    if(pa0 == 0)
-      return -1;
+    if(locked)
+      acquire(&curproc->mmlock);
+    pa0 = uva2kaw(pgdir, (char*)va0);
     n = PGSIZE - (va - va0);
     if(n > len)
       n = len;
-    memmove(pa0 + (va - va0), buf, n);
+    if(pa0)
+      memmove(pa0 + (va - va0), buf, n);
+    if(locked)
+      release(&curproc->mmlock);
+    if(pa0 == 0)
+      return -1;
     len -= n;
     buf += n;
     va = va0 + PGSIZE;
@@ -475,12 +786,12 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
 
 // added the wmap function
 uint
-wmap(uint addr, int length, int flags, int fd)
+wmap(uint addr, int length, int flags, int fd, uint offset)
 {
   struct proc *p = myproc();
 
-  // validate flags
-  if (!(flags & MAP_FIXED) || !(flags & MAP_SHARED)) {
+  // validate flags: MAP_FIXED, and exactly one of MAP_SHARED or MAP_PRIVATE
+  if (!(flags & MAP_FIXED) || !(flags & MAP_SHARED) == !(flags & MAP_PRIVATE)) {
     return FAILED;
   }
 
@@ -499,8 +810,51 @@ wmap(uint addr, int length, int flags, int fd)
     return FAILED;
   }
 
+  // the file offset must be page-aligned too, and only makes sense for a file
+  if ((offset % PGSIZE) != 0 || ((flags & MAP_ANONYMOUS) && offset != 0)) {
+    return FAILED;
+  }
+
+  // a uffd region is anonymous; fd names the uffd, not a file to map
+  struct file *uf = 0;
+  if (flags & MAP_UFFD) {
+    if (!(flags & MAP_ANONYMOUS) || fd < 0 || fd >= NOFILE) {
+      return FAILED;
+    }
+    uf = p->ofile[fd];
+    if (!uf || uf->type != FD_UFFD) {
+      return FAILED;
+    }
+  }
+
+  // to handle file backed mapping
+  struct file *f = 0;
+  if (!(flags & MAP_ANONYMOUS)) {
+    if (fd < 0 || fd >= NOFILE) {
+      return FAILED;
+    }
+
+    f = p->ofile[fd];
+
+    if (!f) {
+      return FAILED;
+    }
+
+    // only files and shared-memory objects can be mapped, and an
+    // object only as far as its size
+    if (f->type != FD_INODE && f->type != FD_SHM) {
+      return FAILED;
+    }
+    if (f->type == FD_SHM && offset + length > shmsize(f->shm)) {
+      return FAILED;
+    }
+  }
+
+  acquire(&p->mmlock);
+
   // tracking the mapping for lazy alocation
   if (p->num_mmaps >= MAX_WMMAP_INFO){
+    release(&p->mmlock);
     return FAILED;
   }
 
@@ -514,39 +868,37 @@ wmap(uint addr, int length, int flags, int fd)
     uint new_end = addr + PGROUNDUP(length);
 
     if (!(new_end <= existing_start || addr >= existing_end)){
+      release(&p->mmlock);
       return FAILED;
     }
   }
 
+  // only the process that made the uffd can hand it its faults
+  if (uf && uffdreg(uf->uffd) < 0) {
+    release(&p->mmlock);
+    return FAILED;
+  }
+
   struct mmap_region *region = &p->mmaps[p->num_mmaps++];
   region->start_addr = addr;
   region->length = length;
 
-  // to handle file backed mapping
-  if (!(flags & MAP_ANONYMOUS)) {
-    if (fd < 0 || fd >= NOFILE) {
-      return FAILED;
-    }
-
-    struct file *f = p->ofile[fd];
-
-    if (!f) {
-      return FAILED;
-    }
-
+  // anonymous mappings have no file
+  if (f) {
     filedup(f);
-
-    region->f = f;
-  }
-
-  else {
-    // anonymous mapping
-    region->f = 0;
   }
+  region->f = f;
+  region->offset = offset;
+  region->dirtysince = 0;
+  region->nextfault = 0;
+  region->window = 0;
+  region->rdonly = 0;
+  region->uffd = uf ? uf->uffd : 0;
 
   region->flags = flags;
   region->fd = fd;
   region->loaded_pages = 0;
+  release(&p->mmlock);
 
   // to ensure lazy allocation, no physical pages are allocated here.
   // they will be allocated in trap.c when there is a page fault
@@ -556,6 +908,41 @@ wmap(uint addr, int length, int flags, int fd)
 
 }
 
+// Pages taken out of a page table by unmapfn, to be written back and
+// freed by wunmap once mmlock has been dropped.
+#define UNMAPBATCH 32
+
+struct unmapbatch {
+  int n;
+  uint next;              // where to resume once the batch is full
+  uint va[UNMAPBATCH];
+  uint pte[UNMAPBATCH];
+};
+
+static int
+unmapfn(pte_t *pte, uint va, int n, void *arg)
+{
+  struct unmapbatch *b = arg;
+
+  for(; n > 0; n--, pte++, va += PGSIZE){
+    if(*pte & PTE_SWAP){
+      swapfree(pte);
+      continue;
+    }
+    if(!(*pte & PTE_P))
+      continue;
+    if(b->n == UNMAPBATCH){
+      b->next = va;
+      return 1;
+    }
+    b->va[b->n] = va;
+    b->pte[b->n] = *pte;
+    b->n++;
+    *pte = 0;
+  }
+  return 0;
+}
+
 // added the wunmap implementation
 int 
 wunmap(uint addr)
@@ -566,121 +953,297 @@ wunmap(uint addr)
   }
 
   struct proc *p = myproc();
-  struct mmap_region *region = 0;
+  struct mmap_region region;
   int i;
 
+  acquire(&p->mmlock);
+
   // locate the memory address starting at addr
   for (i = 0; i < p->num_mmaps; i++){
     if (p->mmaps[i].start_addr == addr){
-      region = &p->mmaps[i];
       break;
     }
   }
 
   // return an error if no matching is found
-  if (!region){
+  if (i == p->num_mmaps){
+    release(&p->mmlock);
     return FAILED;
   }
 
-  // calculate the number of pages to unmap
-  int num_pages = PGROUNDUP(region->length) / PGSIZE;
-  char *va = (char *)region->start_addr;
+  // take the region out of mmaps[] first, so that nothing can fault
+  // pages back into it while it is being torn down
+  region = p->mmaps[i];
 
-  // apply the unmapping to each page
-  for (int j = 0; j < num_pages; j++, va += PGSIZE){
-    pte_t *pte = walkpgdir(p->pgdir, va, 0);
-    
-    // first check if the page is mapped
-    if (pte && (*pte & PTE_P)){
-      uint pa = PTE_ADDR(*pte);
+  // shift entries in the mmap array to fill in the gaps
+  for (int k = i; k < p->num_mmaps - 1; k++){
+    p->mmaps[k] = p->mmaps[k + 1];
+  }
+
+  // decrement the mmap counter
+  p->num_mmaps--;
+  release(&p->mmlock);
+
+  // take the pages out of the page table a batch at a time under
+  // mmlock, then write them back (which sleeps) and free them with
+  // the lock dropped, through their kernel addresses.
+  uint start = region.start_addr;
+  uint end = region.start_addr + PGROUNDUP(region.length);
+  struct unmapbatch b;
+  int more;
+
+  // huge pages are only ever anonymous, so there is nothing to write back
+  acquire(&p->mmlock);
+  hugerange(p->pgdir, start, end, 1);
+  release(&p->mmlock);
+
+  do {
+    b.n = 0;
+    acquire(&p->mmlock);
+    more = walkrange(p->pgdir, start, end, unmapfn, &b);
+    release(&p->mmlock);
+
+    for (int j = 0; j < b.n; j++){
+      uint pa = PTE_ADDR(b.pte[j]);
 
-      decr_ref_count(pa / PGSIZE);
+      // if the mapping is MAP_SHARED, then write data back to file
+      // (before the page is freed below). only pages written since
+      // they were read in or last flushed (PTE_D) need it.
+      // shared-memory objects keep their own reference to the page
+      // and have nothing to write to.
+      if ((region.flags & MAP_SHARED) && region.f && region.f->type == FD_INODE && !region.f->ip) {
+        cprintf("wunmap: Invalid inode pointrt\n");
+      }
+      else if ((region.flags & MAP_SHARED) && region.f && region.f->type == FD_INODE && (b.pte[j] & PTE_D)) {
 
-      // kfree((char *)P2V(pa));
+        uint pgoff = b.va[j] - region.start_addr;
+        int bytes_to_write = min(PGSIZE, region.length - pgoff);
+        int n = filewriteat(region.f, P2V(pa), region.offset + pgoff, bytes_to_write);
 
-      if (get_ref_count(pa / PGSIZE) == 0){
+        if (n != bytes_to_write) {
+          cprintf("wunmap: file write error\n");
+        }
+      }
+
+      if (decr_ref_count(pa) == 0){
         char *page = P2V(pa);
         kfree(page);
       }
+    }
+    start = b.next;
+  } while (more);
 
-      // if the mapping is MAP_SHARED, then write data back to file
-      if ((region->flags & MAP_SHARED) && region->f) {
+  // drop any stale translations for the unmapped range
+  lcr3(V2P(p->pgdir));
 
-        if (!region->f->ip) {
-          cprintf("wunmap: Invalid inode pointrt\n");
-          continue;
-        }
+  if (region.f) {
+    fileclose(region.f);
+  }
+  protfree(&region);
+  if (region.uffd) {
+    uffdunreg(region.uffd);
+  }
+
+  // if you have reached this step, then it means success!
+  return SUCCESS;
+  
+}
 
-        struct file *f = region->f;
-        // uint file_offset = (uint)va - region->start_addr;
-        uint file_offset = (uint)va - region->start_addr;
-        // filewrite(f, va, PGSIZE);
+// Order of the kalloc_pages block holding r's protection bitmap,
+// one bit per page.
+static int
+protorder(struct mmap_region *r)
+{
+  uint bytes;
+  int order;
 
-        begin_op();
-        ilock(f->ip);
-        // int n = writei(f->ip, va, file_offset, PGSIZE);
-        int bytes_to_write = min(PGSIZE, region->length - file_offset);
-        int n = writei(f->ip, va, file_offset, bytes_to_write);
-        iunlock(f->ip);
-        end_op();
+  bytes = (PGROUNDUP(r->length) / PGSIZE + 7) / 8;
+  for(order = 0; (PGSIZE << order) < bytes; order++)
+    ;
+  return order;
+}
 
-        if (n != bytes_to_write) {
-          cprintf("wunmap: file write error\n");
-        }
-      }
+// Whether the page at va in r may be written, as far as wprotect is
+// concerned.
+int
+pagewritable(struct mmap_region *r, uint va)
+{
+  uint i;
 
-      *pte = 0;
+  if(r->rdonly == 0)
+    return 1;
+  i = (va - r->start_addr) / PGSIZE;
+  return !(r->rdonly[i / 8] & (1 << (i % 8)));
+}
 
-    }
-  }
+// Give r, just copied from a parent's region by fork, its own copy of
+// the protection bitmap. Returns -1 if out of memory, leaving r with
+// none.
+int
+protdup(struct mmap_region *r)
+{
+  uchar *map;
 
-  if (region->f) {
-    fileclose(region->f);
-    region->f = 0;
+  if(r->rdonly == 0)
+    return 0;
+  map = r->rdonly;
+  if((r->rdonly = (uchar*)kalloc_pages(protorder(r))) == 0)
+    return -1;
+  memmove(r->rdonly, map, PGSIZE << protorder(r));
+  return 0;
+}
+
+void
+protfree(struct mmap_region *r)
+{
+  if(r->rdonly)
+    kfree_pages((char*)r->rdonly, protorder(r));
+  r->rdonly = 0;
+}
+
+// Give r, restored from a checkpoint, the protection bitmap saved in
+// ip at off. Caller holds ip's lock. Returns -1 if out of memory or
+// the bitmap can't be read, leaving r with none.
+int
+protread(struct mmap_region *r, struct inode *ip, uint off)
+{
+  int n;
+
+  n = (PGROUNDUP(r->length) / PGSIZE + 7) / 8;
+  if((r->rdonly = (uchar*)kalloc_pages(protorder(r))) == 0)
+    return -1;
+  memset(r->rdonly, 0, PGSIZE << protorder(r));
+  if(readi(ip, (char*)r->rdonly, off, n) != n){
+    protfree(r);
+    return -1;
   }
+  return 0;
+}
 
-  // shift entries in the mmap array to fill in the gaps
-  for (int k = i; k < p->num_mmaps - 1; k++){
-    p->mmaps[k] = p->mmaps[k + 1];
+struct protarg {
+  int write;
+  int private;
+};
+
+static int
+protfn(pte_t *pte, uint va, int n, void *arg)
+{
+  struct protarg *pa = arg;
+
+  for(; n > 0; n--, pte++){
+    if(!(*pte & (PTE_P|PTE_SWAP)))
+      continue;
+    if(!pa->write){
+      *pte &= ~(PTE_W|PTE_COW);
+    } else if(!(*pte & (PTE_W|PTE_COW))){
+      // a private page that someone else still maps gets its own
+      // copy on the first write, as after fork
+      if(pa->private && (*pte & PTE_P) && get_ref_count(PTE_ADDR(*pte)) > 1)
+        *pte |= PTE_COW;
+      else
+        *pte |= PTE_W;
+    }
   }
+  return 0;
+}
 
-  // decrement the mmap counter
-  p->num_mmaps--;
+// Past this many pages, reloading cr3 beats flushing them one by one.
+#define INVLPGMAX 32
 
-  // if you have reached this step, then it means success!
+// Set the protection of the pages in [addr, addr+length), which must
+// lie inside one of the caller's wmap regions, to prot: PROT_READ,
+// with or without PROT_WRITE. The pages already mapped are rewritten
+// in place; the region's bitmap covers the ones not faulted in yet.
+int
+wprotect(uint addr, int length, int prot)
+{
+  struct proc *p = myproc();
+  struct mmap_region *r = 0;
+  struct protarg pa;
+  uint end, va, k;
+  int i;
+
+  if(addr % PGSIZE || length <= 0 || prot & ~(PROT_READ|PROT_WRITE) || !(prot & PROT_READ))
+    return FAILED;
+  end = PGROUNDUP(addr + length);
+
+  acquire(&p->mmlock);
+  for(i = 0; i < p->num_mmaps; i++){
+    r = &p->mmaps[i];
+    if(addr >= r->start_addr && end <= r->start_addr + PGROUNDUP(r->length))
+      break;
+  }
+  if(i == p->num_mmaps || hugerange(p->pgdir, addr, end, 0) < 0){
+    release(&p->mmlock);
+    return FAILED;
+  }
+  pa.write = prot & PROT_WRITE;
+  pa.private = r->flags & MAP_PRIVATE;
+  if(!pa.write && r->rdonly == 0){
+    if((r->rdonly = (uchar*)kalloc_pages(protorder(r))) == 0){
+      release(&p->mmlock);
+      return FAILED;
+    }
+    memset(r->rdonly, 0, PGSIZE << protorder(r));
+  }
+  if(r->rdonly){
+    for(va = addr; va < end; va += PGSIZE){
+      k = (va - r->start_addr) / PGSIZE;
+      if(pa.write)
+        r->rdonly[k / 8] &= ~(1 << (k % 8));
+      else
+        r->rdonly[k / 8] |= 1 << (k % 8);
+    }
+  }
+
+  walkrange(p->pgdir, addr, end, protfn, &pa);
+  if((end - addr) / PGSIZE <= INVLPGMAX){
+    for(va = addr; va < end; va += PGSIZE)
+      invlpg((void*)va);
+  } else {
+    lcr3(V2P(p->pgdir));
+  }
+  release(&p->mmlock);
   return SUCCESS;
-  
 }
 
 // increase the reference count for a physical page if it is accessed by multiple processes
 void 
 incr_ref_count(uint pa)
 {
-  int index = pa / PGSIZE;
-  if (index >= 0 && index < MAX_PAGES){
-    ref_counts[index]++;
+  uchar *ref = pageref(pa);
+  if (ref){
+    acquire(&reflock);
+    (*ref)++;
+    release(&reflock);
   }
 }
 
-// decrease the reference count for a physical page if the process is done executing or is killed
-void 
+// decrease the reference count for a physical page if the process is done executing or is killed.
+// returns the new count, so the caller that drops the last reference is the one that frees the page
+int 
 decr_ref_count(uint pa)
 {
-  int index = pa / PGSIZE;
-  if (index >= 0 && index < MAX_PAGES){
-    if (ref_counts[index] > 0){
-      ref_counts[index]--;
+  uchar *ref = pageref(pa);
+  int n = 0;
+  if (ref){
+    acquire(&reflock);
+    if (*ref > 0){
+      (*ref)--;
     }
+    n = *ref;
+    release(&reflock);
   }
+  return n;
 }
 
 // get the reference count for a physical page
 int 
 get_ref_count(uint pa)
 {
-  int index = pa / PGSIZE;
-  if (index >= 0 && index < MAX_PAGES){
-    return ref_counts[index];
+  uchar *ref = pageref(pa);
+  if (ref){
+    return *ref;
   }
   return 0;
 }
@@ -690,6 +1253,12 @@ uint
 va2pa(uint va)
 {
   struct proc *p = myproc();
+  pde_t pde = p->pgdir[PDX(va)];
+
+  if (va < KERNBASE && (pde & PTE_PS)){
+    return PTE_ADDR(pde) | (va & (HUGEPGSIZE-1));
+  }
+
   pte_t *pte = walkpgdir(p->pgdir, (void *)va, 0);
 
   if (!pte || !(*pte & PTE_P)){
@@ -700,6 +1269,33 @@ va2pa(uint va)
   return pa;
 }
 
+// 4KB pages mapped by the huge pages in [start, end), which
+// walkrange skips
+static int
+hugepages(pde_t *pgdir, uint start, uint end)
+{
+  uint va;
+  int n;
+
+  n = 0;
+  va = (start + HUGEPGSIZE-1) & ~(HUGEPGSIZE-1);
+  for(; va + HUGEPGSIZE <= end && va < KERNBASE; va += HUGEPGSIZE)
+    if(pgdir[PDX(va)] & PTE_PS)
+      n += NPTENTRIES;
+  return n;
+}
+
+static int
+countfn(pte_t *pte, uint va, int n, void *arg)
+{
+  int *count = arg;
+
+  for(; n > 0; n--, pte++)
+    if(*pte & PTE_P)
+      (*count)++;
+  return 0;
+}
+
 // adding the implementation of the getwmapinfo system call
 int
 getwmapinfo(struct wmapinfo *winfo)
@@ -708,6 +1304,7 @@ getwmapinfo(struct wmapinfo *winfo)
   struct wmapinfo info;
   int i;
 
+  acquire(&p->mmlock);
   info.total_mmaps = p->num_mmaps;
 
   for (i = 0; i < p->num_mmaps && i < MAX_WMMAP_INFO; i++) {
@@ -717,16 +1314,12 @@ getwmapinfo(struct wmapinfo *winfo)
 
     // count the number of loaded pages
     int loaded_pages = 0;
-
-    for (uint va = region->start_addr; va < region->start_addr + region->length; va += PGSIZE) {
-      pte_t *pte = walkpgdir(p->pgdir, (void*)va, 0);
-      if (pte && (*pte & PTE_P)) {
-        loaded_pages++;
-      }
-    }
+    walkrange(p->pgdir, region->start_addr, region->start_addr + region->length, countfn, &loaded_pages);
+    loaded_pages += hugepages(p->pgdir, region->start_addr, region->start_addr + region->length);
 
     info.n_loaded_pages[i] = loaded_pages;
   }
+  release(&p->mmlock);
 
   if (copyout(p->pgdir, (uint)winfo, &info, sizeof(struct wmapinfo)) < 0) {
     return FAILED;
@@ -735,6 +1328,82 @@ getwmapinfo(struct wmapinfo *winfo)
   return SUCCESS;
 }
 
+int
+vmknob(int knob)
+{
+  return vmtunable[knob].val;
+}
+
+// Set knob to val, unless val is negative. Returns the old value,
+// or -1 if there is no such knob or val is out of range. The swap
+// watermarks can't cross: kswapd would then start reclaiming below a
+// target it is already above.
+int
+vmtune(int knob, int val)
+{
+  int old;
+
+  if(knob < 0 || knob >= NVMTUNE)
+    return -1;
+  old = vmtunable[knob].val;
+  if(val >= 0){
+    if(val < vmtunable[knob].min || val > vmtunable[knob].max)
+      return -1;
+    if((knob == VM_SWAP_LOW && val > vmtunable[VM_SWAP_HIGH].val) ||
+       (knob == VM_SWAP_HIGH && val < vmtunable[VM_SWAP_LOW].val))
+      return -1;
+    vmtunable[knob].val = val;
+  }
+  return old;
+}
+
+// number of page-table pages in use, for meminfo
+int
+pgtablepages(void)
+{
+  return ptpages;
+}
+
+// count the resident, shared, copy-on-write and wmap pages in the
+// user part of p's page table. Caller holds p->mmlock.
+void
+uvmstat(struct proc *p, struct pmeminfo *pm)
+{
+  pde_t *pde;
+  pte_t *pgtab;
+  uint i, j, va;
+
+  pm->pid = p->pid;
+  pm->resident = pm->shared = pm->cow = pm->wmap = pm->swapped = pm->huge = 0;
+  for(i = 0; i < PDX(KERNBASE); i++){
+    pde = &p->pgdir[i];
+    if(!(*pde & PTE_P))
+      continue;
+    if(*pde & PTE_PS){
+      pm->huge++;
+      pm->resident += NPTENTRIES;
+      if(is_shared(p, PGADDR(i, 0, 0)))
+        pm->wmap += NPTENTRIES;
+      continue;
+    }
+    pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
+    for(j = 0; j < NPTENTRIES; j++){
+      if(pgtab[j] & PTE_SWAP)
+        pm->swapped++;
+      if(!(pgtab[j] & PTE_P))
+        continue;
+      va = PGADDR(i, j, 0);
+      pm->resident++;
+      if(get_ref_count(PTE_ADDR(pgtab[j])) > 1)
+        pm->shared++;
+      if(pgtab[j] & PTE_COW)
+        pm->cow++;
+      if(is_shared(p, va))
+        pm->wmap++;
+    }
+  }
+}
+
 //PAGEBREAK!
 // Blank page.
 //PAGEBREAK!
@@ -6,9 +6,15 @@
 
 // these memory locations can be changes - these values are from the hint's provided in the project description
 // Flags for wmap
+#define MAP_PRIVATE 0x0001
 #define MAP_SHARED 0x0002
 #define MAP_ANONYMOUS 0x0004
 #define MAP_FIXED 0x0008
+#define MAP_UFFD 0x0010      // faults go to the uffd passed as fd
+
+// Protections for wprotect
+#define PROT_READ 0x0001
+#define PROT_WRITE 0x0002
 
 // When any system call fails, returns -1
 #define FAILED -1
@@ -24,10 +30,15 @@ struct wmapinfo {
     int n_loaded_pages[MAX_WMMAP_INFO]; // Number of pages physically loaded into memory
 };
 
-// declared the wmap function prototype here to access it in sysproc.c
-uint wmap(uint addr, int length, int flags, int fd);
-
-// declared the wunmap function prototype here to access it
-int wunmap(uint addr);
+// for `getwsinfo`: pages touched between the last two kidled scans
+struct wsinfo {
+    int scans;                          // kidled scans of the process so far
+    int heap_resident;                  // pages present below sz at the last scan
+    int heap_touched;                   // those accessed since the scan before
+    int total_mmaps;                    // wmap regions at the last scan
+    int addr[MAX_WMMAP_INFO];           // Starting address of mapping
+    int resident[MAX_WMMAP_INFO];       // pages present at the last scan
+    int touched[MAX_WMMAP_INFO];        // those accessed since the scan before
+};
 
 #endif
@@ -130,6 +130,13 @@ xchg(volatile uint *addr, uint newval)
   return result;
 }
 
+// Add n to *addr atomically.
+static inline void
+atomicadd(volatile int *addr, int n)
+{
+  asm volatile("lock; addl %1, %0" : "+m" (*addr) : "r" (n) : "cc");
+}
+
 static inline uint
 rcr2(void)
 {
@@ -144,6 +151,20 @@ lcr3(uint val)
   asm volatile("movl %0,%%cr3" : : "r" (val));
 }
 
+static inline void
+invlpg(void *addr)
+{
+  asm volatile("invlpg (%0)" : : "r" (addr) : "memory");
+}
+
+static inline uint64
+rdtsc(void)
+{
+  uint64 val;
+  asm volatile("rdtsc" : "=A" (val));
+  return val;
+}
+
 //PAGEBREAK: 36
 // Layout of the trap frame built on the stack by the
 // hardware and by trapasm.S, and passed to trap().
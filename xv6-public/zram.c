@@ -0,0 +1,250 @@
+// Compressed in-memory swap.
+//
+// A swapped-out page is compressed with a small LZ77 coder and kept
+// in a kmalloc block, found through a slot number stored in the
+// page's PTE (see swap.c). Pages that don't compress to ZRAMMAXLEN
+// bytes are refused and stay resident; all-zero pages take no space.
+//
+// Compressed format: a sequence of items, each starting with a
+// control byte c. If c < 0x80, c+1 literal bytes follow. Otherwise
+// the item is a match of (c & 0x7f) + 4 bytes copied from a 16-bit
+// little-endian distance back in the output.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "spinlock.h"
+
+#define NZSLOT      4096            // pages the pool can hold
+#define ZRAMMAXLEN  1024            // largest kmalloc size class
+#define ZHASHBITS   11            // one page of ushort
+#define ZMINMATCH   4
+#define ZMAXMATCH   (0x7f + ZMINMATCH)
+#define ZMAXLIT     0x80
+
+struct zslot {
+  char *data;                       // 0 for a free slot or a zero page
+  ushort len;
+  uchar used;
+};
+
+static struct {
+  struct spinlock lock;             // protects everything below
+  struct zslot slot[NZSLOT];
+  int hint;                         // where to start looking for a free slot
+  int nused;                        // pages stored
+  int nbytes;                       // compressed bytes stored
+} zram;
+
+void
+zraminit(void)
+{
+  initlock(&zram.lock, "zram");
+  zram.hint = 1;                    // slot 0 is never used
+}
+
+static uint
+load32(uchar *p)
+{
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint)p[3] << 24;
+}
+
+// Append the literals src[from, to) to dst. Returns the new output
+// length, or -1 if it would pass max.
+static int
+putlits(uchar *dst, int op, int max, uchar *src, int from, int to)
+{
+  int n;
+
+  while(from < to){
+    n = to - from;
+    if(n > ZMAXLIT)
+      n = ZMAXLIT;
+    if(op + 1 + n > max)
+      return -1;
+    dst[op++] = n - 1;
+    memmove(dst + op, src + from, n);
+    op += n;
+    from += n;
+  }
+  return op;
+}
+
+// Compress the page at src into dst, using hash, a page of the
+// caller's, as the match finder. Returns the compressed length, or
+// -1 if it doesn't fit in max bytes.
+static int
+compress(uchar *src, uchar *dst, int max, ushort *hash)
+{
+  int ip, anchor, op, ref, len;
+  uint seq, h;
+
+  memset(hash, 0, sizeof(ushort) << ZHASHBITS);
+  ip = anchor = op = 0;
+  while(ip + ZMINMATCH <= PGSIZE){
+    seq = load32(src + ip);
+    h = (seq * 2654435761U) >> (32 - ZHASHBITS);
+    ref = hash[h] - 1;
+    hash[h] = ip + 1;
+    if(ref < 0 || load32(src + ref) != seq){
+      ip++;
+      continue;
+    }
+    if((op = putlits(dst, op, max, src, anchor, ip)) < 0)
+      return -1;
+    len = ZMINMATCH;
+    while(ip + len < PGSIZE && len < ZMAXMATCH && src[ref + len] == src[ip + len])
+      len++;
+    if(op + 3 > max)
+      return -1;
+    dst[op++] = 0x80 | (len - ZMINMATCH);
+    dst[op++] = (ip - ref) & 0xff;
+    dst[op++] = (ip - ref) >> 8;
+    ip += len;
+    anchor = ip;
+  }
+  return putlits(dst, op, max, src, anchor, PGSIZE);
+}
+
+// Expand len bytes at src into the page at dst. Returns 0, or -1 if
+// the data is corrupt.
+static int
+decompress(uchar *src, int len, uchar *dst)
+{
+  int ip, op, n, dist;
+
+  ip = op = 0;
+  while(ip < len){
+    if(src[ip] < 0x80){
+      n = src[ip++] + 1;
+      if(ip + n > len || op + n > PGSIZE)
+        return -1;
+      memmove(dst + op, src + ip, n);
+      ip += n;
+      op += n;
+    } else {
+      n = (src[ip++] & 0x7f) + ZMINMATCH;
+      if(ip + 2 > len)
+        return -1;
+      dist = src[ip] | src[ip+1] << 8;
+      ip += 2;
+      if(dist == 0 || dist > op || op + n > PGSIZE)
+        return -1;
+      // byte by byte: the source may overlap what is being written
+      for(; n > 0; n--, op++)
+        dst[op] = dst[op - dist];
+    }
+  }
+  return op == PGSIZE ? 0 : -1;
+}
+
+static int
+zeropage(uint *p)
+{
+  int i;
+
+  for(i = 0; i < PGSIZE / sizeof(uint); i++)
+    if(p[i])
+      return 0;
+  return 1;
+}
+
+// Store a compressed copy of the page at v. Returns its slot, or -1
+// if the pool is full, the page doesn't compress well enough, or
+// there is no memory for the copy. The page is compressed into
+// buffers of this call's own; zram.lock is held only to take a slot.
+int
+zramstore(char *v)
+{
+  int i, n, len;
+  char *data, *buf, *hash;
+
+  data = 0;
+  len = 0;
+  if(!zeropage((uint*)v)){
+    if((hash = kalloc()) == 0)
+      return -1;
+    if((buf = kmalloc(ZRAMMAXLEN)) == 0){
+      kfree(hash);
+      return -1;
+    }
+    len = compress((uchar*)v, (uchar*)buf, ZRAMMAXLEN, (ushort*)hash);
+    kfree(hash);
+    if(len >= 0 && (data = kmalloc(len)) != 0)
+      memmove(data, buf, len);
+    kmfree(buf);
+    if(data == 0)
+      return -1;
+  }
+
+  acquire(&zram.lock);
+  i = zram.hint;
+  for(n = 0; n < NZSLOT; n++, i++){
+    if(i >= NZSLOT)
+      i = 1;
+    if(!zram.slot[i].used)
+      break;
+  }
+  if(n == NZSLOT){
+    release(&zram.lock);
+    if(data)
+      kmfree(data);
+    return -1;
+  }
+  zram.slot[i].data = data;
+  zram.slot[i].len = len;
+  zram.slot[i].used = 1;
+  zram.hint = i + 1;
+  zram.nused++;
+  zram.nbytes += len;
+  release(&zram.lock);
+  return i;
+}
+
+// Expand slot into the page at v.
+void
+zramload(int slot, char *v)
+{
+  struct zslot *z;
+
+  acquire(&zram.lock);
+  z = &zram.slot[slot];
+  if(slot <= 0 || slot >= NZSLOT || !z->used)
+    panic("zramload");
+  if(z->data == 0)
+    memset(v, 0, PGSIZE);
+  else if(decompress((uchar*)z->data, z->len, (uchar*)v) < 0)
+    panic("zramload: corrupt");
+  release(&zram.lock);
+}
+
+void
+zramfree(int slot)
+{
+  struct zslot *z;
+
+  acquire(&zram.lock);
+  z = &zram.slot[slot];
+  if(slot <= 0 || slot >= NZSLOT || !z->used)
+    panic("zramfree");
+  if(z->data)
+    kmfree(z->data);
+  zram.nused--;
+  zram.nbytes -= z->len;
+  z->data = 0;
+  z->len = 0;
+  z->used = 0;
+  release(&zram.lock);
+}
+
+// Pages stored and compressed bytes used, for meminfo.
+void
+zramstat(int *pages, int *bytes)
+{
+  acquire(&zram.lock);
+  *pages = zram.nused;
+  *bytes = zram.nbytes;
+  release(&zram.lock);
+}
@@ -0,0 +1,123 @@
+// Program templates for fast launches.
+//
+// zygote(path) loads the ELF program at path once, into a page table
+// the kernel keeps, and returns a handle for it. spawn_from(handle,
+// argv) then starts a child running the program without exec: the
+// template's pages are shared with the child copy-on-write, and only
+// a fresh stack holding argv is allocated. The child gets the caller's
+// open files and directory, as with fork.
+//
+// A template is the program as loaded, before it has run. Calling
+// zygote with the same path again loads it afresh, for a program that
+// changed on disk; children already started keep the pages they have.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+#define NZYGOTE   8
+#define ZPATHLEN  64
+
+struct zygote {
+  char path[ZPATHLEN];        // empty for a free slot
+  char name[16];              // last element of path, for p->name
+  pde_t *pgdir;
+  uint sz;
+  uint entry;
+};
+
+static struct {
+  struct spinlock lock;       // protects everything below
+  struct zygote z[NZYGOTE];
+} ztable;
+
+void
+zygoteinit(void)
+{
+  initlock(&ztable.lock, "zygote");
+}
+
+// Load path as a template. Returns its handle, or -1.
+int
+zygote(char *path)
+{
+  struct zygote *z, *free;
+  pde_t *pgdir, *old;
+  uint sz, entry;
+  char *s, *last;
+  int i;
+
+  if(strlen(path) >= ZPATHLEN)
+    return -1;
+  // loading sleeps, so it is done before the table is locked
+  if((pgdir = loadelf(path, &sz, &entry)) == 0)
+    return -1;
+
+  acquire(&ztable.lock);
+  free = 0;
+  for(z = ztable.z; z < &ztable.z[NZYGOTE]; z++){
+    if(z->pgdir && strncmp(z->path, path, ZPATHLEN) == 0)
+      break;
+    if(free == 0 && z->pgdir == 0)
+      free = z;
+  }
+  if(z == &ztable.z[NZYGOTE] && (z = free) == 0){
+    release(&ztable.lock);
+    freevm(pgdir);
+    return -1;
+  }
+  old = z->pgdir;
+  safestrcpy(z->path, path, ZPATHLEN);
+  for(last=s=path; *s; s++)
+    if(*s == '/')
+      last = s+1;
+  safestrcpy(z->name, last, sizeof(z->name));
+  z->pgdir = pgdir;
+  z->sz = sz;
+  z->entry = entry;
+  i = z - ztable.z;
+  release(&ztable.lock);
+
+  if(old)
+    freevm(old);
+  return i;
+}
+
+// Start a child running template id with arguments argv. Returns its
+// pid, or -1.
+int
+spawn_from(int id, char **argv)
+{
+  struct zygote *z;
+  pde_t *pgdir;
+  uint sz, sp, entry;
+  char name[16];
+
+  if(id < 0 || id >= NZYGOTE)
+    return -1;
+  acquire(&ztable.lock);
+  z = &ztable.z[id];
+  if(z->pgdir == 0){
+    release(&ztable.lock);
+    return -1;
+  }
+  // the template is never written, so the copy-on-write marks copyuvm
+  // leaves in it cost nothing
+  pgdir = copyuvm(z->pgdir, z->sz);
+  sz = z->sz;
+  entry = z->entry;
+  safestrcpy(name, z->name, sizeof(name));
+  release(&ztable.lock);
+  if(pgdir == 0)
+    return -1;
+
+  if((sp = pushargv(pgdir, &sz, argv)) == 0){
+    freevm(pgdir);
+    return -1;
+  }
+  return spawn(pgdir, sz, entry, sp, name);
+}